@@ -0,0 +1,394 @@
+/*
+Allocation microbenchmark: joint allocations against one malloc per section.
+
+Build and run from the repository root (there is no build system; any C++17 compiler will do):
+
+	g++ -std=c++17 -O2 -DNDEBUG -I. Benchmarks/AllocationBench.cpp -o AllocationBench
+	./AllocationBench > allocation.json
+	./AllocationBench --quick --out allocation.json
+
+Every combination of section count (1 to 64), section size class (small, medium, large) and section
+alignment (natural, 16, 64) is run with each of these methods:
+
+	separate_malloc		one malloc per section (JointAlignedMalloc when the alignment needs it)
+	joint_init_list		JointPointerAllocate with an initializer_list, malloc
+	joint_array		JointPointerAllocate with a JointPointer_t array, malloc
+	joint_aligned		JointPointerAllocate with a JointPointer_t array, JointAlignedMalloc
+	joint_arena		JointPointerAllocate with a JointPointer_t array, JointArena (freed with Reset)
+
+Each run keeps a batch of blocks alive, writes the first byte of every section, then frees the batch, the way
+a short-lived working set would. For each run the output has:
+
+	ops_per_second		allocate + free pairs per second, timed over whole batches
+	alloc_ns, free_ns	per-call latency percentiles, timed call by call in a separate pass
+				(joint_arena's free is its Reset divided over the batch)
+	requested_bytes		sum of the section sizes of one block
+	footprint_bytes		bytes the allocator really set aside for one block (malloc_usable_size with glibc;
+				for the arena, the block size rounded up to its alignment, without chunk slack)
+	counters		cycles, instructions, cache misses and dTLB load misses per allocate + free pair,
+				from perf_event_open; null when the kernel doesn't allow it (see perf_event_paranoid)
+
+The output is one JSON document, so results can be kept and compared across releases.
+*/
+
+#include "../JointPointerMath.h"
+#include "BenchCommon.h"
+
+#include <utility>
+
+#define JOINTBENCH_MAX_SECTIONS 64
+
+enum JointBenchMethod
+{
+	JOINTBENCH_SEPARATE_MALLOC,
+	JOINTBENCH_INIT_LIST,
+	JOINTBENCH_ARRAY,
+	JOINTBENCH_ALIGNED,
+	JOINTBENCH_ARENA,
+	JOINTBENCH_METHOD_COUNT
+};
+
+static const char* MethodNames[JOINTBENCH_METHOD_COUNT] = { "separate_malloc", "joint_init_list", "joint_array", "joint_aligned", "joint_arena" };
+
+struct SizeClass_t
+{
+	const char* Name;
+	size_t Min;
+	size_t Max;
+};
+
+static const SizeClass_t SizeClasses[] = { { "small", 8, 64 }, { "medium", 64, 1024 }, { "large", 4096, 65536 } };
+static const int SectionCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+static const size_t Alignments[] = { 0, 16, 64 }; // 0 is the natural alignment of a double.
+
+struct Run_t
+{
+	int Method;
+	int NumSections;
+	const SizeClass_t* Sizes;
+	size_t Alignment;
+	size_t SectionSizes[JOINTBENCH_MAX_SECTIONS];
+	size_t Batch;
+	size_t Rounds;
+};
+
+// One live block: either one buffer, or one buffer per section.
+struct Block_t
+{
+	void* Memory;
+	void* Sections[JOINTBENCH_MAX_SECTIONS];
+};
+
+struct Bench_t
+{
+	const Run_t* Run;
+	JointPointer_t Elems[JOINTBENCH_MAX_SECTIONS];
+	void* Pointers[JOINTBENCH_MAX_SECTIONS];
+	JointArena Arena;
+
+	explicit Bench_t(const Run_t& R)
+	{
+		Run = &R;
+		for (int i=0; i <R.NumSections; i++)
+		{
+			Elems[i] = JointPointer_t(&Pointers[i], R.SectionSizes[i], SectionAlignment());
+		}
+	}
+
+	size_t SectionAlignment() const
+	{
+		return Run->Alignment != 0 ? Run->Alignment : std::alignment_of<double>::value;
+	}
+
+	template<size_t... Is> void* AllocateInitList(std::index_sequence<Is...>)
+	{
+		return JointPointerAllocate(nullptr, malloc, { JointPointer_t(&Pointers[Is], Run->SectionSizes[Is], SectionAlignment())... });
+	}
+
+	// initializer_list sizes are fixed at compile time, so every section count gets its own instantiation.
+	void* AllocateInitList()
+	{
+		switch (Run->NumSections)
+		{
+		case 1: return AllocateInitList(std::make_index_sequence<1>());
+		case 2: return AllocateInitList(std::make_index_sequence<2>());
+		case 4: return AllocateInitList(std::make_index_sequence<4>());
+		case 8: return AllocateInitList(std::make_index_sequence<8>());
+		case 16: return AllocateInitList(std::make_index_sequence<16>());
+		case 32: return AllocateInitList(std::make_index_sequence<32>());
+		case 64: return AllocateInitList(std::make_index_sequence<64>());
+		}
+		return nullptr;
+	}
+
+	void Allocate(Block_t& Block)
+	{
+		switch (Run->Method)
+		{
+		case JOINTBENCH_SEPARATE_MALLOC:
+			Block.Memory = nullptr;
+			for (int i=0; i <Run->NumSections; i++)
+			{
+				Block.Sections[i] = Run->Alignment > std::alignment_of<std::max_align_t>::value ? JointAlignedMalloc(Run->SectionSizes[i], Run->Alignment) : malloc(Run->SectionSizes[i]);
+				Pointers[i] = Block.Sections[i];
+			}
+			break;
+		case JOINTBENCH_INIT_LIST:
+			Block.Memory = AllocateInitList();
+			break;
+		case JOINTBENCH_ARRAY:
+			Block.Memory = JointPointerAllocate(nullptr, malloc, Run->NumSections, Elems);
+			break;
+		case JOINTBENCH_ALIGNED:
+			Block.Memory = JointPointerAllocate(nullptr, JointAlignedMalloc, Run->NumSections, Elems);
+			break;
+		case JOINTBENCH_ARENA:
+			Block.Memory = JointPointerAllocate(nullptr, Arena, Run->NumSections, Elems);
+			break;
+		}
+		for (int i=0; i <Run->NumSections; i++)
+		{
+			*(char*)Pointers[i] = (char)i;
+		}
+		JointBenchKeep(Pointers[0]);
+	}
+
+	void Free(Block_t& Block)
+	{
+		switch (Run->Method)
+		{
+		case JOINTBENCH_SEPARATE_MALLOC:
+			for (int i=0; i <Run->NumSections; i++)
+			{
+				if (Run->Alignment > std::alignment_of<std::max_align_t>::value)
+				{
+					JointAlignedFree(Block.Sections[i]);
+				}
+				else
+				{
+					free(Block.Sections[i]);
+				}
+			}
+			break;
+		case JOINTBENCH_INIT_LIST:
+		case JOINTBENCH_ARRAY:
+			free(Block.Memory);
+			break;
+		case JOINTBENCH_ALIGNED:
+			JointAlignedFree(Block.Memory);
+			break;
+		case JOINTBENCH_ARENA:
+			break;
+		}
+	}
+
+	// Called after every block of a batch was given to Free.
+	void EndBatch()
+	{
+		if (Run->Method == JOINTBENCH_ARENA)
+		{
+			Arena.Reset();
+		}
+	}
+
+	size_t Footprint(Block_t& Block)
+	{
+		size_t Total = 0;
+		switch (Run->Method)
+		{
+		case JOINTBENCH_SEPARATE_MALLOC:
+			for (int i=0; i <Run->NumSections; i++)
+			{
+				Total += JointBenchUsableSize(Block.Sections[i], Run->SectionSizes[i]);
+			}
+			break;
+		case JOINTBENCH_INIT_LIST:
+		case JOINTBENCH_ARRAY:
+		case JOINTBENCH_ALIGNED:
+			Total = JointBenchUsableSize(Block.Memory, JointPointerTotalSize(Run->NumSections, Elems));
+			break;
+		case JOINTBENCH_ARENA:
+			Total = JointAlignUp(JointPointerTotalSize(Run->NumSections, Elems), JointPointerMaxAlignment(Run->NumSections, Elems));
+			break;
+		}
+		return Total;
+	}
+};
+
+static void Measure(JointBenchJson& Json, const Run_t& Run, JointBenchCounters& Counters)
+{
+	Bench_t Bench(Run);
+	std::vector<Block_t> Blocks(Run.Batch);
+
+	// Warm up, and measure the footprint of a full batch.
+	size_t Footprint = 0;
+	for (size_t b=0; b <Run.Batch; b++)
+	{
+		Bench.Allocate(Blocks[b]);
+	}
+	for (size_t b=0; b <Run.Batch; b++)
+	{
+		Footprint += Bench.Footprint(Blocks[b]);
+		Bench.Free(Blocks[b]);
+	}
+	Bench.EndBatch();
+
+	// Throughput, with the counters running.
+	Counters.Start();
+	uint64_t Start = JointBenchNow();
+	for (size_t r=0; r <Run.Rounds; r++)
+	{
+		for (size_t b=0; b <Run.Batch; b++)
+		{
+			Bench.Allocate(Blocks[b]);
+		}
+		for (size_t b=0; b <Run.Batch; b++)
+		{
+			Bench.Free(Blocks[b]);
+		}
+		Bench.EndBatch();
+	}
+	uint64_t Elapsed = JointBenchNow() - Start;
+	Counters.Stop();
+	uint64_t Operations = (uint64_t)Run.Rounds * Run.Batch;
+
+	// Latency, one call at a time.
+	std::vector<uint64_t> AllocSamples;
+	std::vector<uint64_t> FreeSamples;
+	AllocSamples.reserve(Operations);
+	FreeSamples.reserve(Operations);
+	for (size_t r=0; r <Run.Rounds; r++)
+	{
+		for (size_t b=0; b <Run.Batch; b++)
+		{
+			uint64_t Before = JointBenchNow();
+			Bench.Allocate(Blocks[b]);
+			AllocSamples.push_back(JointBenchNow() - Before);
+		}
+		uint64_t BatchStart = JointBenchNow();
+		for (size_t b=0; b <Run.Batch; b++)
+		{
+			uint64_t Before = JointBenchNow();
+			Bench.Free(Blocks[b]);
+			FreeSamples.push_back(JointBenchNow() - Before);
+		}
+		if (Run.Method == JOINTBENCH_ARENA)
+		{
+			Bench.EndBatch();
+			uint64_t PerBlock = (JointBenchNow() - BatchStart) / Run.Batch;
+			for (size_t b=FreeSamples.size() - Run.Batch; b <FreeSamples.size(); b++)
+			{
+				FreeSamples[b] = PerBlock;
+			}
+		}
+	}
+
+	size_t Requested = 0;
+	for (int i=0; i <Run.NumSections; i++)
+	{
+		Requested += Run.SectionSizes[i];
+	}
+
+	Json.BeginObject();
+	Json.String("method", MethodNames[Run.Method]);
+	Json.Integer("sections", (uint64_t)Run.NumSections);
+	Json.String("size_class", Run.Sizes->Name);
+	Json.Integer("alignment", (uint64_t)Bench.SectionAlignment());
+	Json.Integer("batch", (uint64_t)Run.Batch);
+	Json.Integer("operations", Operations);
+	Json.Number("ops_per_second", Elapsed > 0 ? (double)Operations * 1e9 / (double)Elapsed : 0.0);
+	Json.Percentiles("alloc_ns", JointBenchSummarise(AllocSamples));
+	Json.Percentiles("free_ns", JointBenchSummarise(FreeSamples));
+	Json.Integer("requested_bytes", (uint64_t)Requested);
+	Json.Number("footprint_bytes", (double)Footprint / (double)Run.Batch);
+	Json.Number("overhead_ratio", Requested > 0 ? (double)Footprint / (double)Run.Batch / (double)Requested : 0.0);
+	Json.Counters("counters", Counters, Operations);
+	Json.EndObject();
+}
+
+int main(int argc, char** argv)
+{
+	bool Quick = false;
+	const char* OutPath = nullptr;
+	for (int i=1; i <argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0)
+		{
+			Quick = true;
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			OutPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--quick] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	FILE* Out = stdout;
+	if (OutPath != nullptr)
+	{
+		Out = fopen(OutPath, "w");
+		if (Out == nullptr)
+		{
+			fprintf(stderr, "can't open %s\n", OutPath);
+			return 1;
+		}
+	}
+
+	// Live memory per run is capped, so the large size class with many sections doesn't need gigabytes.
+	const size_t LiveBudget = 16 * 1024 * 1024;
+	const uint64_t TargetOperations = Quick ? 5000 : 100000;
+
+	JointBenchCounters Counters;
+	JointBenchJson Json(Out);
+	Json.BeginObject();
+	Json.String("benchmark", "allocation");
+#if defined(__VERSION__)
+	Json.String("compiler", __VERSION__);
+#endif
+	Json.Boolean("quick", Quick);
+	Json.Boolean("perf_counters", Counters.Available(JOINTBENCH_CYCLES));
+	Json.BeginArray("results");
+	for (const SizeClass_t& Sizes : SizeClasses)
+	{
+		for (int NumSections : SectionCounts)
+		{
+			for (size_t Alignment : Alignments)
+			{
+				Run_t Run;
+				Run.NumSections = NumSections;
+				Run.Sizes = &Sizes;
+				Run.Alignment = Alignment;
+				JointBenchRandom Random((uint64_t)NumSections * 1000003u + Sizes.Min);
+				size_t Requested = 0;
+				for (int i=0; i <NumSections; i++)
+				{
+					Run.SectionSizes[i] = Random.Range(Sizes.Min, Sizes.Max);
+					Requested += Run.SectionSizes[i];
+				}
+				Run.Batch = LiveBudget / Requested;
+				Run.Batch = Run.Batch > 64 ? 64 : (Run.Batch < 4 ? 4 : Run.Batch);
+				Run.Rounds = (size_t)(TargetOperations / Run.Batch);
+				Run.Rounds = Run.Rounds < 1 ? 1 : Run.Rounds;
+				for (int Method=0; Method <JOINTBENCH_METHOD_COUNT; Method++)
+				{
+					Run.Method = Method;
+					Measure(Json, Run, Counters);
+					fflush(Out);
+				}
+			}
+		}
+	}
+	Json.EndArray();
+	Json.EndObject();
+	fputc('\n', Out);
+
+	if (Out != stdout)
+	{
+		fclose(Out);
+	}
+	return 0;
+}
@@ -0,0 +1,377 @@
+/*
+Shared helpers for the JointPointerMath benchmarks: timing, latency percentiles, hardware counters
+through perf_event_open, and a small JSON writer. Not part of the library.
+*/
+
+#ifndef JOINT_POINTER_MATH_BENCH_COMMON_H
+#define JOINT_POINTER_MATH_BENCH_COMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <malloc.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define JOINTBENCH_HAS_PERF 1
+#else
+#define JOINTBENCH_HAS_PERF 0
+#endif
+
+inline uint64_t JointBenchNow()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Stops the compiler from optimising away work whose result is otherwise unused.
+inline void JointBenchKeep(void* Ptr)
+{
+#if defined(__GNUC__)
+	__asm__ __volatile__("" : : "r"(Ptr) : "memory");
+#else
+	static void* volatile Sink;
+	Sink = Ptr;
+#endif
+}
+
+// Deterministic, so every run and every method sees the same sizes.
+struct JointBenchRandom
+{
+	uint64_t State;
+
+	explicit JointBenchRandom(uint64_t Seed)
+	{
+		State = Seed * 0x9e3779b97f4a7c15ull + 1;
+	}
+
+	uint64_t Next()
+	{
+		State ^= State << 13;
+		State ^= State >> 7;
+		State ^= State << 17;
+		return State;
+	}
+
+	size_t Range(size_t Min, size_t Max)
+	{
+		return Min + (size_t)(Next() % (Max - Min + 1));
+	}
+};
+
+// Bytes the allocator really set aside for a malloc'd block, or Size if that can't be asked.
+inline size_t JointBenchUsableSize(void* Memory, size_t Size)
+{
+#if defined(__GLIBC__)
+	(void)Size;
+	return Memory != nullptr ? malloc_usable_size(Memory) : 0;
+#else
+	(void)Memory;
+	return Size;
+#endif
+}
+
+struct JointBenchPercentiles
+{
+	double P50;
+	double P90;
+	double P99;
+	double P999;
+	double Max;
+	double Mean;
+};
+
+inline JointBenchPercentiles JointBenchSummarise(std::vector<uint64_t>& Samples)
+{
+	JointBenchPercentiles Result;
+	memset(&Result, 0, sizeof(Result));
+	if (Samples.empty())
+	{
+		return Result;
+	}
+	std::sort(Samples.begin(), Samples.end());
+	size_t Last = Samples.size() - 1;
+	Result.P50 = (double)Samples[Last * 50 / 100];
+	Result.P90 = (double)Samples[Last * 90 / 100];
+	Result.P99 = (double)Samples[Last * 99 / 100];
+	Result.P999 = (double)Samples[Last * 999 / 1000];
+	Result.Max = (double)Samples[Last];
+	double Sum = 0;
+	for (size_t i=0; i <Samples.size(); i++)
+	{
+		Sum += (double)Samples[i];
+	}
+	Result.Mean = Sum / (double)Samples.size();
+	return Result;
+}
+
+enum JointBenchCounter
+{
+	JOINTBENCH_CYCLES,
+	JOINTBENCH_INSTRUCTIONS,
+	JOINTBENCH_CACHE_MISSES,
+	JOINTBENCH_DTLB_MISSES,
+	JOINTBENCH_COUNTER_COUNT
+};
+
+inline const char* JointBenchCounterName(int Counter)
+{
+	static const char* Names[JOINTBENCH_COUNTER_COUNT] = { "cycles", "instructions", "cache_misses", "dtlb_load_misses" };
+	return Names[Counter];
+}
+
+// Hardware counters for the calling thread, user space only. Counters the kernel won't give us
+// (no PMU, perf_event_paranoid, containers) are reported as unavailable rather than failing the run.
+struct JointBenchCounters
+{
+	int Fds[JOINTBENCH_COUNTER_COUNT];
+	uint64_t Values[JOINTBENCH_COUNTER_COUNT];
+
+	JointBenchCounters()
+	{
+		for (int i=0; i <JOINTBENCH_COUNTER_COUNT; i++)
+		{
+			Fds[i] = -1;
+			Values[i] = 0;
+		}
+#if JOINTBENCH_HAS_PERF
+		Fds[JOINTBENCH_CYCLES] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		Fds[JOINTBENCH_INSTRUCTIONS] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		Fds[JOINTBENCH_CACHE_MISSES] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		Fds[JOINTBENCH_DTLB_MISSES] = Open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+	}
+
+	~JointBenchCounters()
+	{
+#if JOINTBENCH_HAS_PERF
+		for (int i=0; i <JOINTBENCH_COUNTER_COUNT; i++)
+		{
+			if (Fds[i] >= 0)
+			{
+				close(Fds[i]);
+			}
+		}
+#endif
+	}
+
+	JointBenchCounters(const JointBenchCounters&) = delete;
+	JointBenchCounters& operator=(const JointBenchCounters&) = delete;
+
+	bool Available(int Counter) const
+	{
+		return Fds[Counter] >= 0;
+	}
+
+	void Start()
+	{
+#if JOINTBENCH_HAS_PERF
+		for (int i=0; i <JOINTBENCH_COUNTER_COUNT; i++)
+		{
+			if (Fds[i] >= 0)
+			{
+				ioctl(Fds[i], PERF_EVENT_IOC_RESET, 0);
+				ioctl(Fds[i], PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	void Stop()
+	{
+#if JOINTBENCH_HAS_PERF
+		for (int i=0; i <JOINTBENCH_COUNTER_COUNT; i++)
+		{
+			Values[i] = 0;
+			if (Fds[i] >= 0)
+			{
+				ioctl(Fds[i], PERF_EVENT_IOC_DISABLE, 0);
+				if (read(Fds[i], &Values[i], sizeof(Values[i])) != (ssize_t)sizeof(Values[i]))
+				{
+					Values[i] = 0;
+				}
+			}
+		}
+#endif
+	}
+
+private:
+#if JOINTBENCH_HAS_PERF
+	static int Open(uint32_t Type, uint64_t Config)
+	{
+		perf_event_attr Attr;
+		memset(&Attr, 0, sizeof(Attr));
+		Attr.size = sizeof(Attr);
+		Attr.type = Type;
+		Attr.config = Config;
+		Attr.disabled = 1;
+		Attr.exclude_kernel = 1;
+		Attr.exclude_hv = 1;
+		return (int)syscall(SYS_perf_event_open, &Attr, 0, -1, -1, 0);
+	}
+#endif
+};
+
+// Writes one JSON document. Commas are handled by remembering whether the current object or array is empty.
+struct JointBenchJson
+{
+	FILE* Out;
+	std::vector<bool> Empty;
+
+	explicit JointBenchJson(FILE* File)
+	{
+		Out = File;
+	}
+
+	void BeginObject(const char* Key = nullptr)
+	{
+		Prefix(Key);
+		fputc('{', Out);
+		Empty.push_back(true);
+	}
+
+	void EndObject()
+	{
+		Close('}');
+	}
+
+	void BeginArray(const char* Key = nullptr)
+	{
+		Prefix(Key);
+		fputc('[', Out);
+		Empty.push_back(true);
+	}
+
+	void EndArray()
+	{
+		Close(']');
+	}
+
+	void String(const char* Key, const char* Value)
+	{
+		Prefix(Key);
+		Quoted(Value);
+	}
+
+	void Number(const char* Key, double Value)
+	{
+		Prefix(Key);
+		fprintf(Out, "%.17g", Value);
+	}
+
+	void Integer(const char* Key, uint64_t Value)
+	{
+		Prefix(Key);
+		fprintf(Out, "%llu", (unsigned long long)Value);
+	}
+
+	void Boolean(const char* Key, bool Value)
+	{
+		Prefix(Key);
+		fputs(Value ? "true" : "false", Out);
+	}
+
+	void Null(const char* Key)
+	{
+		Prefix(Key);
+		fputs("null", Out);
+	}
+
+	void Percentiles(const char* Key, const JointBenchPercentiles& Value)
+	{
+		BeginObject(Key);
+		Number("p50", Value.P50);
+		Number("p90", Value.P90);
+		Number("p99", Value.P99);
+		Number("p999", Value.P999);
+		Number("max", Value.Max);
+		Number("mean", Value.Mean);
+		EndObject();
+	}
+
+	void Counters(const char* Key, const JointBenchCounters& Value, uint64_t Operations)
+	{
+		BeginObject(Key);
+		for (int i=0; i <JOINTBENCH_COUNTER_COUNT; i++)
+		{
+			if (Value.Available(i))
+			{
+				Number(JointBenchCounterName(i), Operations > 0 ? (double)Value.Values[i] / (double)Operations : 0.0);
+			}
+			else
+			{
+				Null(JointBenchCounterName(i));
+			}
+		}
+		EndObject();
+	}
+
+private:
+	void Close(char Bracket)
+	{
+		bool WasEmpty = Empty.back();
+		Empty.pop_back();
+		if (!WasEmpty)
+		{
+			Indent();
+		}
+		fputc(Bracket, Out);
+	}
+
+	void Indent()
+	{
+		fputc('\n', Out);
+		for (size_t i=0; i <Empty.size(); i++)
+		{
+			fputc(' ', Out);
+			fputc(' ', Out);
+		}
+	}
+
+	void Prefix(const char* Key)
+	{
+		if (!Empty.empty())
+		{
+			if (!Empty.back())
+			{
+				fputc(',', Out);
+			}
+			Empty.back() = false;
+			Indent();
+		}
+		if (Key != nullptr)
+		{
+			Quoted(Key);
+			fputs(": ", Out);
+		}
+	}
+
+	void Quoted(const char* Value)
+	{
+		fputc('"', Out);
+		for (const char* C = Value; *C != 0; C++)
+		{
+			if (*C == '"' || *C == '\\')
+			{
+				fputc('\\', Out);
+				fputc(*C, Out);
+			}
+			else if ((unsigned char)*C < 0x20)
+			{
+				fprintf(Out, "\\u%04x", (unsigned char)*C);
+			}
+			else
+			{
+				fputc(*C, Out);
+			}
+		}
+		fputc('"', Out);
+	}
+};
+
+#endif
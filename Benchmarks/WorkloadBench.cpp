@@ -0,0 +1,634 @@
+/*
+Workload benchmark: how fast data laid out with JointPointerAllocate is traversed, compared with the same
+data spread over separate allocations in a fragmented heap.
+
+Build and run from the repository root (there is no build system; any C++17 compiler will do):
+
+	g++ -std=c++17 -O2 -DNDEBUG -I. Benchmarks/WorkloadBench.cpp -o WorkloadBench
+	./WorkloadBench > workload.json
+	./WorkloadBench --quick --out workload.json
+
+Workloads:
+
+	mesh		many small meshes (vec3 vertices + unsigned short indices, as in the README); every index is
+			followed to its vertex, which is transformed. One element is one index.
+	particles	many emitters, each a structure of arrays (position, velocity, life); every particle is
+			integrated one step. One element is one particle.
+	bfs		breadth-first search over a random graph. The joint version is a CSR graph (row offsets,
+			columns, distances and queue in one block); the scattered version has one neighbour list
+			per vertex. One element is one edge.
+	columns		a table split into row groups, each holding four columns; a filtered sum over all rows.
+			One element is one row.
+
+Each workload is built twice. "joint" allocates each object (mesh, emitter, row group, graph) with
+JointPointerAllocate; "scattered" gives every section its own malloc. Before building, the heap is fragmented
+(lots of small blocks of random size, half of them freed again), and both versions make a small noise
+allocation after each of their own allocations, so neither gets a fresh heap to itself.
+
+For each workload and layout the output has ns_per_element, and cache misses and dTLB load misses per
+element from perf_event_open (null when the kernel doesn't allow it). The checksum must be the same for
+both layouts of a workload; it only shows the two did the same work.
+*/
+
+#include "../JointPointerMath.h"
+#include "BenchCommon.h"
+
+struct vec3
+{
+	float X;
+	float Y;
+	float Z;
+};
+
+// Keeps the heap fragmented while the workloads are built and run.
+struct Noise_t
+{
+	std::vector<void*> Blocks;
+	JointBenchRandom Random;
+
+	Noise_t() : Random(12345)
+	{
+	}
+
+	~Noise_t()
+	{
+		for (void* Block : Blocks)
+		{
+			free(Block);
+		}
+	}
+
+	void Fragment(size_t Count)
+	{
+		size_t First = Blocks.size();
+		for (size_t i=0; i <Count; i++)
+		{
+			Blocks.push_back(malloc(Random.Range(16, 1024)));
+		}
+		for (size_t i=First; i <Blocks.size(); i++)
+		{
+			if ((Random.Next() & 1) != 0)
+			{
+				free(Blocks[i]);
+				Blocks[i] = Blocks.back();
+				Blocks.pop_back();
+			}
+		}
+	}
+
+	void Interleave()
+	{
+		Blocks.push_back(malloc(Random.Range(16, 256)));
+	}
+};
+
+struct Result_t
+{
+	double Nanoseconds;
+	uint64_t Elements;
+	double Checksum;
+	JointBenchCounters* Counters;
+};
+
+template<typename F> Result_t Time(JointBenchCounters& Counters, int Repeat, F&& Traverse)
+{
+	Result_t Result;
+	Result.Checksum = Traverse();
+	Result.Elements = 0;
+	Counters.Start();
+	uint64_t Start = JointBenchNow();
+	for (int r=0; r <Repeat; r++)
+	{
+		Result.Elements += (uint64_t)Traverse.Elements();
+		JointBenchKeep(&Result.Checksum);
+		Result.Checksum = Traverse();
+	}
+	Result.Nanoseconds = (double)(JointBenchNow() - Start);
+	Counters.Stop();
+	Result.Counters = &Counters;
+	return Result;
+}
+
+static void Report(JointBenchJson& Json, const char* Workload, const char* Layout, const Result_t& Result)
+{
+	Json.BeginObject();
+	Json.String("workload", Workload);
+	Json.String("layout", Layout);
+	Json.Integer("elements", Result.Elements);
+	Json.Number("ns_per_element", Result.Elements > 0 ? Result.Nanoseconds / (double)Result.Elements : 0.0);
+	JointBenchCounters& Counters = *Result.Counters;
+	if (Counters.Available(JOINTBENCH_CACHE_MISSES))
+	{
+		Json.Number("cache_misses_per_element", (double)Counters.Values[JOINTBENCH_CACHE_MISSES] / (double)Result.Elements);
+	}
+	else
+	{
+		Json.Null("cache_misses_per_element");
+	}
+	if (Counters.Available(JOINTBENCH_DTLB_MISSES))
+	{
+		Json.Number("dtlb_misses_per_element", (double)Counters.Values[JOINTBENCH_DTLB_MISSES] / (double)Result.Elements);
+	}
+	else
+	{
+		Json.Null("dtlb_misses_per_element");
+	}
+	Json.Number("checksum", Result.Checksum);
+	Json.EndObject();
+}
+
+// Mesh: vertices plus indices, walked through the indices.
+
+struct Mesh_t
+{
+	vec3* Vertices;
+	unsigned short* Indices;
+	void* Joint;
+};
+
+struct MeshWorkload
+{
+	std::vector<Mesh_t> Meshes;
+	size_t NumVertices;
+	size_t NumIndices;
+
+	MeshWorkload(size_t NumMeshes, size_t Vertices, size_t Indices, bool Joint, Noise_t& Noise)
+	{
+		NumVertices = Vertices;
+		NumIndices = Indices;
+		Meshes.resize(NumMeshes);
+		JointBenchRandom Random(1);
+		for (Mesh_t& Mesh : Meshes)
+		{
+			if (Joint)
+			{
+				Mesh.Joint = JointPointerAllocate(nullptr, malloc,
+				{
+					JointPointer(&Mesh.Vertices, sizeof(vec3) * NumVertices),
+					JointPointer(&Mesh.Indices, sizeof(unsigned short) * NumIndices)
+				});
+				Noise.Interleave();
+			}
+			else
+			{
+				Mesh.Joint = nullptr;
+				Mesh.Vertices = (vec3*)malloc(sizeof(vec3) * NumVertices);
+				Noise.Interleave();
+				Mesh.Indices = (unsigned short*)malloc(sizeof(unsigned short) * NumIndices);
+				Noise.Interleave();
+			}
+			for (size_t i=0; i <NumVertices; i++)
+			{
+				Mesh.Vertices[i].X = (float)(Random.Next() % 100);
+				Mesh.Vertices[i].Y = (float)(Random.Next() % 100);
+				Mesh.Vertices[i].Z = (float)(Random.Next() % 100);
+			}
+			for (size_t i=0; i <NumIndices; i++)
+			{
+				Mesh.Indices[i] = (unsigned short)(Random.Next() % NumVertices);
+			}
+		}
+	}
+
+	~MeshWorkload()
+	{
+		for (Mesh_t& Mesh : Meshes)
+		{
+			if (Mesh.Joint != nullptr)
+			{
+				free(Mesh.Joint);
+			}
+			else
+			{
+				free(Mesh.Vertices);
+				free(Mesh.Indices);
+			}
+		}
+	}
+
+	size_t Elements() const
+	{
+		return Meshes.size() * NumIndices;
+	}
+
+	double operator()() const
+	{
+		const float M[9] = { 0.8f, -0.6f, 0.0f, 0.6f, 0.8f, 0.0f, 0.0f, 0.0f, 1.0f };
+		float Sum = 0.0f;
+		for (const Mesh_t& Mesh : Meshes)
+		{
+			for (size_t i=0; i <NumIndices; i++)
+			{
+				const vec3& V = Mesh.Vertices[Mesh.Indices[i]];
+				Sum += M[0] * V.X + M[1] * V.Y + M[2] * V.Z;
+				Sum += M[3] * V.X + M[4] * V.Y + M[5] * V.Z;
+				Sum += M[6] * V.X + M[7] * V.Y + M[8] * V.Z;
+			}
+		}
+		return (double)Sum;
+	}
+};
+
+// Particles: one structure of arrays per emitter.
+
+enum
+{
+	PARTICLE_POS_X,
+	PARTICLE_POS_Y,
+	PARTICLE_POS_Z,
+	PARTICLE_VEL_X,
+	PARTICLE_VEL_Y,
+	PARTICLE_VEL_Z,
+	PARTICLE_LIFE,
+	PARTICLE_ARRAYS
+};
+
+struct Emitter_t
+{
+	float* Arrays[PARTICLE_ARRAYS];
+	void* Joint;
+};
+
+struct ParticleWorkload
+{
+	std::vector<Emitter_t> Emitters;
+	size_t NumParticles;
+
+	ParticleWorkload(size_t NumEmitters, size_t Particles, bool Joint, Noise_t& Noise)
+	{
+		NumParticles = Particles;
+		Emitters.resize(NumEmitters);
+		for (Emitter_t& Emitter : Emitters)
+		{
+			if (Joint)
+			{
+				JointPointer_t Elems[PARTICLE_ARRAYS];
+				for (int a=0; a <PARTICLE_ARRAYS; a++)
+				{
+					Elems[a] = JointPointer(&Emitter.Arrays[a], sizeof(float) * NumParticles);
+				}
+				Emitter.Joint = JointPointerAllocate(nullptr, malloc, Elems);
+				Noise.Interleave();
+			}
+			else
+			{
+				Emitter.Joint = nullptr;
+				for (int a=0; a <PARTICLE_ARRAYS; a++)
+				{
+					Emitter.Arrays[a] = (float*)malloc(sizeof(float) * NumParticles);
+					Noise.Interleave();
+				}
+			}
+			for (int a=0; a <PARTICLE_ARRAYS; a++)
+			{
+				for (size_t i=0; i <NumParticles; i++)
+				{
+					Emitter.Arrays[a][i] = (float)((i * 7 + a) % 13);
+				}
+			}
+		}
+	}
+
+	~ParticleWorkload()
+	{
+		for (Emitter_t& Emitter : Emitters)
+		{
+			if (Emitter.Joint != nullptr)
+			{
+				free(Emitter.Joint);
+			}
+			else
+			{
+				for (int a=0; a <PARTICLE_ARRAYS; a++)
+				{
+					free(Emitter.Arrays[a]);
+				}
+			}
+		}
+	}
+
+	size_t Elements() const
+	{
+		return Emitters.size() * NumParticles;
+	}
+
+	// Integrates forward then backward on alternate calls, so the values stay bounded however often it runs.
+	double operator()()
+	{
+		static float Dt = 0.01f;
+		Dt = -Dt;
+		float Sum = 0.0f;
+		for (Emitter_t& Emitter : Emitters)
+		{
+			float* __restrict PosX = Emitter.Arrays[PARTICLE_POS_X];
+			float* __restrict PosY = Emitter.Arrays[PARTICLE_POS_Y];
+			float* __restrict PosZ = Emitter.Arrays[PARTICLE_POS_Z];
+			const float* __restrict VelX = Emitter.Arrays[PARTICLE_VEL_X];
+			const float* __restrict VelY = Emitter.Arrays[PARTICLE_VEL_Y];
+			const float* __restrict VelZ = Emitter.Arrays[PARTICLE_VEL_Z];
+			float* __restrict Life = Emitter.Arrays[PARTICLE_LIFE];
+			for (size_t i=0; i <NumParticles; i++)
+			{
+				PosX[i] += VelX[i] * Dt;
+				PosY[i] += VelY[i] * Dt;
+				PosZ[i] += VelZ[i] * Dt;
+				Life[i] -= Dt;
+			}
+			Sum += PosX[0] + Life[NumParticles - 1];
+		}
+		return (double)Sum;
+	}
+};
+
+// BFS: CSR in one joint block, against one neighbour list per vertex.
+
+struct GraphWorkload
+{
+	bool Joint;
+	uint32_t NumVertices;
+	uint64_t NumEdges;
+
+	// Joint CSR layout.
+	void* Block;
+	uint32_t* RowOffsets;
+	uint32_t* Columns;
+	uint32_t* Distances;
+	uint32_t* Queue;
+
+	// Scattered layout.
+	std::vector<uint32_t*> Neighbours;
+	std::vector<uint32_t> Degrees;
+
+	GraphWorkload(uint32_t Vertices, uint32_t Degree, bool J, Noise_t& Noise)
+	{
+		Joint = J;
+		NumVertices = Vertices;
+		NumEdges = (uint64_t)Vertices * Degree;
+		Block = nullptr;
+		JointBenchRandom Random(7);
+		std::vector<uint32_t> Edges((size_t)NumEdges);
+		for (size_t e=0; e <Edges.size(); e++)
+		{
+			Edges[e] = (uint32_t)(Random.Next() % NumVertices);
+		}
+
+		if (Joint)
+		{
+			Block = JointPointerAllocate(nullptr, malloc,
+			{
+				JointPointer(&RowOffsets, sizeof(uint32_t) * (NumVertices + 1)),
+				JointPointer(&Columns, sizeof(uint32_t) * NumEdges),
+				JointPointer(&Distances, sizeof(uint32_t) * NumVertices),
+				JointPointer(&Queue, sizeof(uint32_t) * NumVertices)
+			});
+			Noise.Interleave();
+			for (uint32_t v=0; v <=NumVertices; v++)
+			{
+				RowOffsets[v] = v * Degree;
+			}
+			memcpy(Columns, Edges.data(), sizeof(uint32_t) * NumEdges);
+		}
+		else
+		{
+			Neighbours.resize(NumVertices);
+			Degrees.assign(NumVertices, Degree);
+			for (uint32_t v=0; v <NumVertices; v++)
+			{
+				Neighbours[v] = (uint32_t*)malloc(sizeof(uint32_t) * Degree);
+				memcpy(Neighbours[v], Edges.data() + (size_t)v * Degree, sizeof(uint32_t) * Degree);
+				Noise.Interleave();
+			}
+			Distances = (uint32_t*)malloc(sizeof(uint32_t) * NumVertices);
+			Noise.Interleave();
+			Queue = (uint32_t*)malloc(sizeof(uint32_t) * NumVertices);
+			Noise.Interleave();
+		}
+	}
+
+	~GraphWorkload()
+	{
+		if (Joint)
+		{
+			free(Block);
+		}
+		else
+		{
+			for (uint32_t* List : Neighbours)
+			{
+				free(List);
+			}
+			free(Distances);
+			free(Queue);
+		}
+	}
+
+	size_t Elements() const
+	{
+		return (size_t)NumEdges;
+	}
+
+	// Edges from vertices that weren't reached aren't walked, so the count is exact only for a connected graph;
+	// with the default average degree almost every vertex is reached.
+	double operator()() const
+	{
+		memset(Distances, 0xff, sizeof(uint32_t) * NumVertices);
+		uint32_t Head = 0;
+		uint32_t Tail = 0;
+		Distances[0] = 0;
+		Queue[Tail++] = 0;
+		uint64_t Sum = 0;
+		while (Head < Tail)
+		{
+			uint32_t V = Queue[Head++];
+			uint32_t Next = Distances[V] + 1;
+			const uint32_t* Begin = Joint ? Columns + RowOffsets[V] : Neighbours[V];
+			const uint32_t* End = Joint ? Columns + RowOffsets[V + 1] : Neighbours[V] + Degrees[V];
+			for (const uint32_t* E = Begin; E != End; E++)
+			{
+				if (Distances[*E] == 0xffffffffu)
+				{
+					Distances[*E] = Next;
+					Queue[Tail++] = *E;
+					Sum += Next;
+				}
+			}
+		}
+		return (double)Sum;
+	}
+};
+
+// Columns: row groups of four columns, scanned with a filter.
+
+struct RowGroup_t
+{
+	int32_t* Keys;
+	float* Prices;
+	int16_t* Quantities;
+	uint8_t* Flags;
+	void* Joint;
+};
+
+struct ColumnWorkload
+{
+	std::vector<RowGroup_t> Groups;
+	size_t NumRows;
+
+	ColumnWorkload(size_t NumGroups, size_t Rows, bool Joint, Noise_t& Noise)
+	{
+		NumRows = Rows;
+		Groups.resize(NumGroups);
+		JointBenchRandom Random(3);
+		for (RowGroup_t& Group : Groups)
+		{
+			if (Joint)
+			{
+				Group.Joint = JointPointerAllocate(nullptr, malloc,
+				{
+					JointPointer(&Group.Keys, sizeof(int32_t) * NumRows),
+					JointPointer(&Group.Prices, sizeof(float) * NumRows),
+					JointPointer(&Group.Quantities, sizeof(int16_t) * NumRows),
+					JointPointer(&Group.Flags, sizeof(uint8_t) * NumRows)
+				});
+				Noise.Interleave();
+			}
+			else
+			{
+				Group.Joint = nullptr;
+				Group.Keys = (int32_t*)malloc(sizeof(int32_t) * NumRows);
+				Noise.Interleave();
+				Group.Prices = (float*)malloc(sizeof(float) * NumRows);
+				Noise.Interleave();
+				Group.Quantities = (int16_t*)malloc(sizeof(int16_t) * NumRows);
+				Noise.Interleave();
+				Group.Flags = (uint8_t*)malloc(sizeof(uint8_t) * NumRows);
+				Noise.Interleave();
+			}
+			for (size_t i=0; i <NumRows; i++)
+			{
+				Group.Keys[i] = (int32_t)(Random.Next() % 1000);
+				Group.Prices[i] = (float)(Random.Next() % 100) * 0.25f;
+				Group.Quantities[i] = (int16_t)(Random.Next() % 50);
+				Group.Flags[i] = (uint8_t)(Random.Next() % 4);
+			}
+		}
+	}
+
+	~ColumnWorkload()
+	{
+		for (RowGroup_t& Group : Groups)
+		{
+			if (Group.Joint != nullptr)
+			{
+				free(Group.Joint);
+			}
+			else
+			{
+				free(Group.Keys);
+				free(Group.Prices);
+				free(Group.Quantities);
+				free(Group.Flags);
+			}
+		}
+	}
+
+	size_t Elements() const
+	{
+		return Groups.size() * NumRows;
+	}
+
+	double operator()() const
+	{
+		double Sum = 0.0;
+		for (const RowGroup_t& Group : Groups)
+		{
+			float GroupSum = 0.0f;
+			for (size_t i=0; i <NumRows; i++)
+			{
+				bool Match = Group.Flags[i] != 0 && Group.Keys[i] < 500;
+				GroupSum += Match ? Group.Prices[i] * (float)Group.Quantities[i] : 0.0f;
+			}
+			Sum += GroupSum;
+		}
+		return Sum;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	bool Quick = false;
+	const char* OutPath = nullptr;
+	for (int i=1; i <argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0)
+		{
+			Quick = true;
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			OutPath = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--quick] [--out file.json]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	FILE* Out = stdout;
+	if (OutPath != nullptr)
+	{
+		Out = fopen(OutPath, "w");
+		if (Out == nullptr)
+		{
+			fprintf(stderr, "can't open %s\n", OutPath);
+			return 1;
+		}
+	}
+
+	const size_t Scale = Quick ? 1 : 8;
+	const int Repeat = Quick ? 3 : 10;
+
+	JointBenchCounters Counters;
+	Noise_t Noise;
+	Noise.Fragment(200000 * Scale);
+
+	JointBenchJson Json(Out);
+	Json.BeginObject();
+	Json.String("benchmark", "workload");
+#if defined(__VERSION__)
+	Json.String("compiler", __VERSION__);
+#endif
+	Json.Boolean("quick", Quick);
+	Json.Boolean("perf_counters", Counters.Available(JOINTBENCH_CACHE_MISSES));
+	Json.BeginArray("results");
+	for (int Joint=1; Joint >=0; Joint--)
+	{
+		const char* Layout = Joint ? "joint" : "scattered";
+		{
+			MeshWorkload Mesh(2048 * Scale, 64, 192, Joint != 0, Noise);
+			Report(Json, "mesh", Layout, Time(Counters, Repeat, Mesh));
+		}
+		{
+			ParticleWorkload Particles(512 * Scale, 256, Joint != 0, Noise);
+			Report(Json, "particles", Layout, Time(Counters, Repeat, Particles));
+		}
+		{
+			GraphWorkload Graph((uint32_t)(65536 * Scale), 8, Joint != 0, Noise);
+			Report(Json, "bfs", Layout, Time(Counters, Repeat, Graph));
+		}
+		{
+			ColumnWorkload Columns(1024 * Scale, 256, Joint != 0, Noise);
+			Report(Json, "columns", Layout, Time(Counters, Repeat, Columns));
+		}
+		fflush(Out);
+	}
+	Json.EndArray();
+	Json.EndObject();
+	fputc('\n', Out);
+
+	if (Out != stdout)
+	{
+		fclose(Out);
+	}
+	return 0;
+}
@@ -35,36 +35,53 @@ Documentation:
 ==============
 
 
-void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t Size), int Num, JointPointer_t* Elems);
-void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t Size, size_t Alignment), int Num, JointPointer_t* Elems);
+template<typename AllocT> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, int Num, JointPointer_t* Elems);
 
 	JointPointerAllocate will calculate the total size required for the buffer, call the given allocator function,
 	perform the pointer maths and write all the given pointers, then returns a pointer to the allocated
 	buffer and optionally writes the size of the buffer to OutSize. (OutSize may be null)
 
-	Note that if you need special alignment (ex 16bytes), you should use the version of JointPointerAllocate
-	that takes an allocator function which can actually do an aligned allocation.
-	Otherwise, the first element will not be properly aligned.
-	If an aligned allocator is provided, the alignment of the new buffer is the alignment of the first element.
+	Note that if you need special alignment (ex 16bytes), you should use an allocator which can actually do an
+	aligned allocation. Otherwise, the first element will not be properly aligned.
+	If an aligned allocator is provided, the alignment of the new buffer is the largest alignment of any section.
 
 	NOTE, on Windows _aligned_malloc takes the size argument first, whereas on Linux,
 	memalign takes the alignment argument first. Hopefully you'll read this and not waste your time.
+	Aligned allocators are always called as Alloc(Size, Alignment); JointAlignedMalloc has that order on every platform.
 
 
-template<int Num> void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size), JointPointer_t (&Arr)[Num]);
-template<int Num> void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size, size_t alignment), JointPointer_t (&Arr)[Num]);
+template<typename AllocT> void* JointAllocatorAllocate(AllocT&& Alloc, size_t Size, size_t Alignment);
+
+	Every function here that allocates takes its allocator as a template parameter, so a lambda or functor is
+	called directly and can be inlined, and can carry state (a per-thread heap, a subsystem's allocator, ...).
+	The first of these that fits is used:
+		Alloc->allocate(Size, Alignment)	a pointer to a memory resource, such as std::pmr::memory_resource*
+		Alloc.allocate(Size, Alignment)		a memory resource by reference
+		Alloc.Allocate(Size, Alignment)		an object such as JointArena
+		Alloc.allocate(Count)			a standard Allocator, through std::allocator_traits rebound to std::max_align_t,
+							so it can't give out more alignment than that. Give the buffer back as
+							JointAllocatorUnits(Size) std::max_align_t to the same allocator.
+		Alloc(Size, Alignment)			a function or callable that can align, such as JointAlignedMalloc
+		Alloc(Size)				a function or callable that can't, such as malloc
+	JointAllocatorAllocate makes the call, for use in your own code.
+
+		void* Buffer = JointPointerAllocate(&TotalSize, [&](size_t Size, size_t Alignment) { return Heap.Alloc(Size, Alignment); }, 2, Elems);
+		void* Buffer = JointPointerAllocate(&TotalSize, std::pmr::get_default_resource(), 2, Elems);
+
+
+template<typename AllocT, int Num> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, JointPointer_t (&Arr)[Num]);
 
 	Helper functions for JointPointerAllocate. Automatically detects array size to avoid copy-paste errors.
 
 
-void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size), std::initializer_list<JointPointer_t> ini);
-void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size, size_t alignment), std::initializer_list<JointPointer_t> ini);
+template<typename AllocT> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, std::initializer_list<JointPointer_t> ini);
 
 	Helper functions for JointPointerAllocate. Used in the example.
 
 
 template<typename T> JointPointer_t JointPointer(T** Ptr, size_t Sz, size_t Align);
 template<typename T> JointPointer_t JointPointer(T** Ptr, size_t Sz);
+template<typename T> JointPointer_t JointPointer(T** Ptr, size_t Sz, size_t Align, unsigned int Flags);
 
 	Helper functions to initialize a JointPointer_t.
 	It avoids having to manually cast Ptr down to void**
@@ -75,6 +92,8 @@ template<typename T> JointPointer_t JointPointer(T** Ptr, size_t Sz);
 	If an alignment isn't specified, it is determined using std::alignment_of and the type of the pointer passed.
 	Note that if the pointer is void*, alignment cannot be determined and you will get a compile error.
 
+	The four argument version also takes a combination of JointPointerFlags, such as JOINTPOINTER_PINNED.
+
 
 size_t JointPointerTotalSize(int Num, JointPointer_t* Elems);
 template<int Num> size_t JointPointerTotalSize(JointPointer_t (&Arr)[Num]);
@@ -83,11 +102,521 @@ template<int Num> size_t JointPointerTotalSize(JointPointer_t (&Arr)[Num]);
 	Calculates and returns the total size of the buffer required, and write the offset to each JointPointer_t element.
 
 
+template<typename T, size_t Count, size_t Align = std::alignment_of<T>::value> struct JointSection;
+template<typename... Sections> struct JointLayout;
+
+	Compile-time version of JointPointerTotalSize and JointPointerWrite, for layouts where the type, element
+	count and alignment of every section is known at compile time.
+	JointLayout<...>::TotalSize, JointLayout<...>::Alignment and JointLayout<...>::Offset<I>() are constants,
+	so allocating reduces to one allocator call followed by constant-offset pointer writes.
+	Alignment is the largest alignment of any section, and is what gets passed to an aligned allocator.
+
+		typedef JointLayout<JointSection<vec3, 4>, JointSection<unsigned short, 6>> MeshLayout;
+		void* Buffer = MeshLayout::Allocate(&TotalSize, malloc, &Vertices, &Indices);
+
+	JointLayout<...>::Write(Memory, Ptrs...) writes the pointers for a buffer you allocated yourself.
+
+
+template<typename T> JointStaticPointer_t<T, std::alignment_of<T>::value> JointStaticPointer(T** Ptr, size_t Sz);
+template<size_t Align, typename T> JointStaticPointer_t<T, Align> JointStaticPointer(T** Ptr, size_t Sz);
+template<typename AllocT, typename... Ts, size_t... Aligns> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, JointStaticPointer_t<Ts, Aligns>... Elems);
+
+	For when the alignments are known at compile time but the sizes are not.
+	Each section's alignment is a template parameter of JointStaticPointer_t, so the offset maths unrolls into
+	straight-line mask-and-add code with no loop and no std::align calls, and the pointers are written with their real type.
+	If an aligned allocator is provided, the alignment of the new buffer is the largest alignment of any section.
+
+		void* Buffer = JointPointerAllocate(&TotalSize, malloc,
+			JointStaticPointer(&Vertices, sizeof(vec3) * NumVertices),
+			JointStaticPointer<16>(&Indices, sizeof(unsigned short) * NumIndices));
+
+
+size_t JointPointerTotalSizePacked(int Num, JointPointer_t* Elems, size_t* OutSaved);
+template<int Num> size_t JointPointerTotalSizePacked(JointPointer_t (&Arr)[Num], size_t* OutSaved);
+template<typename AllocT> void* JointPointerAllocatePacked(size_t* OutSize, size_t* OutSaved, AllocT&& Alloc, int Num, JointPointer_t* Elems);
+template<typename AllocT, int Num> void* JointPointerAllocatePacked(size_t* OutSize, size_t* OutSaved, AllocT&& Alloc, JointPointer_t (&Arr)[Num]);
+
+	Same as JointPointerTotalSize and JointPointerAllocate, except the sections are placed in order of descending
+	alignment instead of the order they are declared in, which removes most of the padding.
+	The sort is stable, and sections flagged with JOINTPOINTER_PINNED keep their declared position.
+	The Elems array itself is not reordered; only the offsets change, so your pointers are still written correctly.
+	The number of bytes saved compared to the declared order is written to OutSaved. (OutSaved may be null)
+	If packing would not save anything, the declared order is used.
+	As everywhere else, an aligned allocator is given the largest alignment of any section.
+
+
+template<typename ReallocT> void* JointPointerReallocate(void* Memory, size_t* OutSize, ReallocT&& Realloc, int Num, const JointPointer_t* OldElems, JointPointer_t* NewElems);
+template<typename ReallocT, int Num> void* JointPointerReallocate(void* Memory, size_t* OutSize, ReallocT&& Realloc, const JointPointer_t (&OldArr)[Num], JointPointer_t (&NewArr)[Num]);
+
+	Resizes the sections of a buffer made by JointPointerAllocate. Realloc is anything callable as Realloc(Memory, Size).
+	OldElems is the layout the buffer was allocated with (offsets included), and NewElems is a copy of it with the new sizes.
+	The new offsets are written to NewElems, and the new pointers are written the same way JointPointerAllocate does.
+	When the buffer grows, Realloc is called first so the allocator gets the chance to grow it in place, then the
+	sections are moved; when it shrinks, the sections are moved first. Sections that don't move are not copied, and
+	neighbouring sections that move by the same distance are moved with a single memmove.
+	Each section keeps min(old size, new size) bytes of its contents.
+	Returns the new buffer, or null if Realloc failed, in which case the old buffer and pointers are left untouched.
+
+		JointPointer_t NewElems[2] = { Elems[0], Elems[1] };
+		NewElems[0].Size = sizeof(vec3) * NewNumVertices;
+		Buffer = JointPointerReallocate(Buffer, &TotalSize, realloc, 2, Elems, NewElems);
+
+	With glibc, realloc moves large blocks with mremap, so big buffers are grown without copying the pages.
+	Both layouts must use the declared section order, so this doesn't work on buffers from JointPointerAllocatePacked.
+	realloc only guarantees the alignment of malloc, so buffers that needed an aligned allocator can't be reallocated this way.
+
+
+struct JointArena;
+JointArena::JointArena(size_t ChunkSize = JOINTPOINTERMATH_ARENA_CHUNK_SIZE, void* (*ChunkAlloc)(size_t Size) = malloc, void (*ChunkFree)(void* Memory) = free);
+void* JointArena::Allocate(size_t Size, size_t Alignment);
+JointArenaMark_t JointArena::Mark() const;
+void JointArena::Rewind(JointArenaMark_t Mark);
+void JointArena::Reset();
+void JointArena::Release();
+
+	A bump-pointer arena for joint allocations that never need to be freed one at a time, such as per-frame
+	or per-request buffers. Memory comes from a chain of chunks of ChunkSize bytes, which are taken from
+	ChunkAlloc when the arena runs out and only given back to ChunkFree by Release or the destructor.
+	Requests larger than ChunkSize get a chunk of their own.
+	Mark/Rewind frees everything allocated since the mark, and Reset frees everything; both are O(1), and the
+	chunks are kept for reuse. Allocate returns null if ChunkAlloc fails.
+	A JointArena can be passed as the allocator to any of the JointPointerAllocate overloads, and the buffer
+	comes from the arena, aligned to the largest alignment of any section.
+
+		JointArena FrameArena;
+		void* Buffer = JointPointerAllocate(nullptr, FrameArena,
+		{
+			JointPointer(&Vertices, sizeof(vec3) * 4),
+			JointPointer(&Indices, sizeof(unsigned short) * 6)
+		});
+		// ....
+		FrameArena.Reset();
+
+
+void* JointAlignedMalloc(size_t Size, size_t Alignment);
+void JointAlignedFree(void* Memory);
+
+	Portable aligned allocator with the (Size, Alignment) argument order JointPointerAllocate expects.
+	Uses _aligned_malloc on Windows and posix_memalign elsewhere. Memory must be freed with JointAlignedFree.
+
+
+struct JointPool;
+JointPool::JointPool(void* (*Alloc)(size_t Size, size_t Alignment) = JointAlignedMalloc, void (*FreeFn)(void* Memory) = JointAlignedFree);
+void* JointPool::Allocate(size_t* OutSize, int Num, JointPointer_t* Elems);
+template<int Num> void* JointPool::Allocate(size_t* OutSize, JointPointer_t (&Arr)[Num]);
+void JointPool::Free(void* Memory);
+void JointPool::Trim();
+
+	Recycles joint buffers that share the same layout (the same sizes, alignments and flags for every section).
+	Allocate works like JointPointerAllocate, but first looks for a freed buffer with the same layout, and
+	writes the pointers into it with JointPointerWrite. Buffers must be given back with JointPool::Free.
+	The contents of a recycled buffer are whatever was left in it.
+
+	Each thread keeps a small cache of freed buffers per layout, so most calls don't take a lock; the caches
+	are refilled from, and overflow into, a shared depot behind a mutex. When a thread exits, its cached
+	buffers go back to the depot. Trim gives every buffer in the depot back to FreeFn.
+	Each buffer carries a pointer-sized header in front of it (rounded up to the buffer alignment) so that
+	Free can tell which layout it belongs to. Buffers are aligned to the largest alignment of any section.
+	The pool must not be destroyed while other threads are still using it.
+
+
+struct JointConcurrentPool;
+JointConcurrentPool::JointConcurrentPool(int Num, JointPointer_t* Elems, void* (*Alloc)(size_t Size, size_t Alignment) = JointAlignedMalloc, void (*FreeFn)(void* Memory) = JointAlignedFree);
+void* JointConcurrentPool::Allocate();
+void* JointConcurrentPool::Allocate(int Num, JointPointer_t* Elems);
+void JointConcurrentPool::Free(void* Memory);
+
+	A lock-free pool of joint buffers that all share one layout, for when buffers are allocated and freed on
+	different threads. The constructor calls JointPointerTotalSize on Elems, so copies of Elems made afterwards
+	can be passed to Allocate, which writes the pointers with JointPointerWrite. The parameterless Allocate
+	just returns the buffer.
+
+	Free buffers sit on Treiber stacks (with a tag next to the index to prevent ABA): one per CPU, found with
+	sched_getcpu where available, plus a shared overflow stack. Allocate pops from the current CPU's stack,
+	then the shared one, then steals from the other CPUs; Free pushes to the current CPU's stack until it holds
+	JOINTPOINTERMATH_CONCURRENT_POOL_CPU_CAPACITY buffers, then to the shared one. Each stack head sits on its own
+	cache line. Only growing the pool takes a lock; buffers are carved out of slabs that double in size, and are
+	not given back to Free until the pool is destroyed. Returns null when Alloc fails.
+	Each buffer carries a 4 byte header in front of it (rounded up to the buffer alignment).
+
+
+struct JointLayoutPlan;
+JointLayoutPlan::JointLayoutPlan(int Num, const JointPointer_t* Elems);
+JointLayoutPlan::JointLayoutPlan(std::initializer_list<JointPointer_t> ini);
+void JointPointerWrite(void* Memory, const JointLayoutPlan& Plan, void*** Dests);
+template<typename AllocT> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, const JointLayoutPlan& Plan, void*** Dests);
+template<typename AllocT, typename... Ts> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, const JointLayoutPlan& Plan, Ts**... Dests);
+
+	JointPointerTotalSize writes the offsets into the JointPointer_t array, so the array can't be shared between
+	threads and every allocation computes the same offsets again. A JointLayoutPlan computes the offsets, the
+	total size and the largest alignment once, from descriptors it doesn't modify (their Pointer fields are ignored),
+	and never changes afterwards, so one plan can be used by any number of threads at once.
+	Allocating with a plan takes the pointers to write separately, either as an array of Plan.Num() destinations
+	or as one argument per section. If an aligned allocator is provided, it is given Plan.Alignment().
+
+		static const JointLayoutPlan MeshPlan = { JointPointer(&Vertices, sizeof(vec3) * 4), JointPointer(&Indices, sizeof(unsigned short) * 6) };
+		void* Buffer = JointPointerAllocate(&TotalSize, malloc, MeshPlan, &Vertices, &Indices);
+
+
+size_t JointPointerBatchStride(int Num, JointPointer_t* Elems);
+void JointPointerWriteBatch(void* Memory, size_t Stride, size_t Count, int Num, JointPointer_t* Elems);
+template<typename AllocT> void* JointPointerAllocateBatch(size_t* OutSize, size_t* OutStride, AllocT&& Alloc, size_t Count, int Num, JointPointer_t* Elems);
+template<typename AllocT, int Num> void* JointPointerAllocateBatch(size_t* OutSize, size_t* OutStride, AllocT&& Alloc, size_t Count, JointPointer_t (&Arr)[Num]);
+
+	Allocates Count buffers with the same layout as one contiguous slab, instead of calling JointPointerAllocate
+	Count times. Here each Elems[i].Pointer points to an array of Count pointers, which receives that section's
+	pointer for every buffer. The buffers are Stride bytes apart, where Stride is the total size rounded up to the
+	largest alignment, so every buffer is aligned the same way as the first one.
+	JointPointerBatchStride computes the offsets (like JointPointerTotalSize) and returns the stride, and
+	JointPointerWriteBatch writes the pointers for a slab you allocated yourself. The whole slab is freed at once.
+	Returns null if Stride * Count doesn't fit in a size_t.
+
+		vec3* Vertices[1000];
+		unsigned short* Indices[1000];
+		JointPointer_t Elems[] =
+		{
+			JointPointer(Vertices, sizeof(vec3) * 4),
+			JointPointer(Indices, sizeof(unsigned short) * 6)
+		};
+		void* Slab = JointPointerAllocateBatch(nullptr, nullptr, malloc, 1000, Elems);
+
+
+void* JointMapAllocate(size_t Size, size_t Alignment, unsigned int Flags);
+void* JointMapAlloc(size_t Size, size_t Alignment);
+void* JointMapReallocate(void* Memory, size_t Size);
+void JointMapFree(void* Memory);
+
+	An allocator backend for very large joint buffers, which maps them straight from the OS with mmap.
+	Flags is a combination of JointMapFlags:
+		JOINTPOINTER_MAP_HUGEPAGES    align the mapping to JOINTPOINTERMATH_HUGE_PAGE_SIZE and ask for transparent huge pages (MADV_HUGEPAGE)
+		JOINTPOINTER_MAP_HUGETLB      try to map explicit huge pages (MAP_HUGETLB) first; falls back to JOINTPOINTER_MAP_HUGEPAGES if none are reserved
+		JOINTPOINTER_MAP_POPULATE     prefault every page up front, so the first touch doesn't stall
+		JOINTPOINTER_MAP_LOCK         mlock the pages, so they are never swapped out (best effort; ignored if the limit is too low)
+	Flags the platform doesn't support are ignored, so you always get at least regular pages.
+	JointMapAlloc has the signature JointPointerAllocate expects from an aligned allocator, and uses
+	JOINTPOINTERMATH_MAP_DEFAULT_FLAGS (JOINTPOINTER_MAP_HUGEPAGES unless you define it).
+	The buffer is the start of the mapping, so it has the alignment asked for (or a huge page's, if more) and a size
+	that is a whole number of pages takes no more. The mapping sizes are kept in a table on the side, so JointMapFree
+	only needs the pointer.
+	JointMapReallocate can be passed to JointPointerReallocate: it resizes the mapping with mremap, in place when
+	it can and otherwise by moving the pages rather than copying them (Linux only).
+	Only available where mmap is (JOINTPOINTERMATH_HAS_MMAP is defined to 1). Returns null on failure.
+
+		void* Buffer = JointPointerAllocate(&TotalSize, JointMapAlloc,
+		{
+			JointPointer(&Positions, sizeof(vec3) * NumParticles),
+			JointPointer(&Velocities, sizeof(vec3) * NumParticles)
+		});
+		// ....
+		JointMapFree(Buffer);
+
+
+void* JointNumaAllocate(size_t Size, size_t Alignment, int Node, unsigned int Flags);
+void* JointNumaAllocLocal(size_t Size, size_t Alignment);
+void* JointNumaAllocInterleaved(size_t Size, size_t Alignment);
+int JointNumaCurrentNode();
+int JointNumaNodeCount();
+
+	Same as JointMapAllocate, but the pages are placed on a chosen NUMA node instead of wherever they are first touched.
+	Node is a node number, JOINTPOINTER_NUMA_LOCAL for the node of the calling thread, or JOINTPOINTER_NUMA_INTERLEAVE
+	to spread the pages round-robin over every node this process may use, which suits read-mostly buffers shared by
+	threads on every socket. The policy is set with mbind before any page is populated or locked.
+	JointNumaAllocLocal and JointNumaAllocInterleaved have the signature JointPointerAllocate expects from an aligned
+	allocator, and use JOINTPOINTERMATH_MAP_DEFAULT_FLAGS. Free the buffer with JointMapFree.
+	If the kernel refuses the policy (no NUMA support, a node that doesn't exist, or a sandbox that blocks mbind),
+	or on platforms other than Linux, the buffer is allocated anyway with the default policy, so this works the same on
+	a single node machine. JointNumaCurrentNode returns 0 and JointNumaNodeCount returns 1 in that case.
+
+
+bool JointImageSave(const char* Path, const void* Memory, int Num, const JointPointer_t* Elems, const char* const* Names);
+bool JointImageLoad(JointImage* Image, const char* Path, int Num, JointPointer_t* Elems);
+void* JointImageFind(const JointImage* Image, const char* Name, size_t* OutSize);
+void JointImageUnload(JointImage* Image);
+
+	Saves a joint buffer to a file and maps it back without copying or parsing anything.
+	The file is a JointImageHeader_t (magic number, version, section count, total size and where the data starts),
+	followed by one JointImageSection_t per section (offset, size, alignment and an optional name), followed by the
+	buffer itself starting on a JOINTPOINTERMATH_IMAGE_DATA_ALIGNMENT boundary. Everything is stored in the byte order
+	of the machine that saved it; a file from a machine with the other byte order fails the magic number check.
+
+	JointImageSave writes Memory, which must have been laid out with Elems (offsets included), to Path.
+	Names may be null, or hold one name per section (each may be null); names longer than
+	JOINTPOINTERMATH_IMAGE_NAME_SIZE - 1 characters are cut short.
+	JointImageLoad maps Path read-only, checks the header and the section table, then checks that Elems has the same
+	number of sections with the same sizes, writes the offsets from the file into Elems and writes the pointers
+	like JointPointerAllocate does. Pass Num = 0 to only map the file and look sections up by name with JointImageFind.
+	The pages are read-only, so writing through the pointers will crash. JointImageUnload unmaps the file.
+	JointImageSave and JointImageLoad return false on any error. Loading needs mmap (JOINTPOINTERMATH_HAS_MMAP).
+
+		JointImageSave("mesh.jpi", Buffer, 2, Elems, nullptr);
+		// ....
+		JointImage Image;
+		if (JointImageLoad(&Image, "mesh.jpi", 2, Elems))
+		{
+			// Vertices and Indices now point into the mapped file.
+		}
+
+
+template<typename T, typename OffsetT = int32_t> struct JointRelPtr;
+template<typename T, typename OffsetT = uint32_t> struct JointOffset;
+
+	Pointers for sections that refer to each other (indices into vertices, child ranges into nodes, ...) which stay
+	valid when the whole buffer is copied with memcpy, moved by JointPointerReallocate or mapped by JointImageLoad.
+	JointRelPtr stores the distance from itself to its target, and behaves like a T*: it can be assigned a T*,
+	compared to null, and dereferenced with *, -> and [] at the cost of one add. Get() returns the T*, or null.
+	A JointRelPtr can't point at itself, since a distance of 0 means null. Copying a JointRelPtr on its own
+	(rather than as part of a whole buffer) keeps it pointing at the same target.
+	JointOffset stores the distance from the start of the buffer instead, so it has to be given the buffer to be
+	read or written: Get(Base) and Set(Base, Ptr). It is trivially copyable and can live in a section that is
+	copied around on its own.
+	With the default 32 bit offsets both are half the size of a pointer on 64 bit machines, and can reach
+	+-2GB (JointRelPtr) or 4GB (JointOffset); use int64_t/uint64_t for bigger buffers. Asserts if a target is out of reach.
+
+		struct Node { JointRelPtr<Node> FirstChild; int NumChildren; };
+		Nodes[0].FirstChild = &Nodes[1];
+		Node* Copy = (Node*)malloc(TotalSize);
+		memcpy(Copy, Nodes, TotalSize);
+		// Copy[0].FirstChild points to Copy[1].
+
+
+JOINTPOINTER_EXCLUSIVE_LINE
+JOINTPOINTERMATH_EXCLUSIVE_LINES
+JOINTPOINTERMATH_CACHE_LINE_SIZE
+
+	For sections written by different threads at the same time (per-worker counters, per-thread output slices).
+	A section flagged with JOINTPOINTER_EXCLUSIVE_LINE starts on a cache line boundary and is padded up to a whole
+	number of cache lines, so no other section shares a line with it. Defining JOINTPOINTERMATH_EXCLUSIVE_LINES to 1
+	does this for every section. The line size is JOINTPOINTERMATH_CACHE_LINE_SIZE: 128 on Apple arm64 and POWER,
+	64 elsewhere, and can be defined before including this file. The flag is honoured by everything that takes a
+	JointPointer_t; with JointLayout and JointStaticPointer, pass the line size as the alignment instead.
+
+		JointPointer(&Counters, sizeof(uint64_t) * NumCounters, alignof(uint64_t), JOINTPOINTER_EXCLUSIVE_LINE)
+
+
+int JointPointerSharedLines(const void* Memory, int Num, const JointPointer_t* Elems, JointPointerSharedLine_t* Out, int MaxOut);
+
+	Reports which sections of a laid out buffer share a cache line, so you can tell which ones to flag.
+	Each pair is written to Out as the indices of the two sections and the first line they share, counted in lines
+	from the line holding the start of the buffer. Returns the number of pairs, which may be more than MaxOut.
+	Memory is only used for its address and may be null, in which case the buffer is assumed to start on a line boundary.
+	Empty sections never share a line.
+
+
+JOINTPOINTER_PAD_16, JOINTPOINTER_PAD_32, JOINTPOINTER_PAD_64
+JOINTPOINTERMATH_SIMD_PAD
+void JointPointerClearPadding(void* Memory, int Num, const JointPointer_t* Elems);
+
+	Lets vector kernels run over whole sections without a scalar or masked tail.
+	A section flagged with JOINTPOINTER_PAD_16/32/64 starts on a boundary of that many bytes, its size is rounded
+	up to a multiple of it, and one more vector of slack follows, so there are always at least that many bytes
+	after Size, even when Size is already a multiple of the width. All of those bytes are zero-filled, so a kernel
+	that steps through the section one full vector at a time from its start, loads a vector from an unaligned
+	position inside it, or runs one vector past the last element can read and write past Size without touching
+	another section. Defining JOINTPOINTERMATH_SIMD_PAD (16, 32, 64, ...) before including this file
+	pads every section. Size and the pointer you get back are unchanged; only the layout and the total size grow.
+	Everything that allocates from a JointPointer_t clears the padding. JointPointerWrite doesn't, since it may be
+	pointing into memory that already holds data; call JointPointerClearPadding (or JointLayoutPlan::ClearPadding)
+	for buffers you lay out yourself. With JointLayout and JointStaticPointer, round the counts and alignment up yourself.
+
+		JointPointer(&Samples, sizeof(float) * NumSamples, alignof(float), JOINTPOINTER_PAD_32)
+		for (size_t i=0; i < NumSamples; i += 8)
+		{
+			_mm256_store_ps(Samples + i, _mm256_mul_ps(_mm256_load_ps(Samples + i), Gain));
+		}
+
+
+struct JointMemoryResource : std::pmr::memory_resource;
+JointMemoryResource::JointMemoryResource(void* Memory, size_t Size, JointResourceMode Mode = JOINTPOINTER_RESOURCE_MONOTONIC, std::pmr::memory_resource* Upstream = std::pmr::null_memory_resource());
+JointMemoryResource::JointMemoryResource(const JointPointer_t& Section, JointResourceMode Mode = JOINTPOINTER_RESOURCE_MONOTONIC, std::pmr::memory_resource* Upstream = std::pmr::null_memory_resource());
+void JointMemoryResource::Release();
+size_t JointMemoryResource::Used() const;
+
+	Hands out a section of a joint buffer (or a whole buffer) to standard containers, so a std::pmr::vector or
+	std::pmr::string whose worst case size is known up front grows inside the joint allocation instead of on the heap.
+	The second constructor takes the JointPointer_t the section was allocated with, after its pointer was written.
+	In JOINTPOINTER_RESOURCE_MONOTONIC mode deallocation does nothing and the memory comes back with Release().
+	In JOINTPOINTER_RESOURCE_LIFO mode, freeing the most recent allocation gives its bytes back, which covers a
+	container growing in place of its own old storage, or containers destroyed in reverse order of creation.
+	When the section runs out, requests go to Upstream; by default that's std::pmr::null_memory_resource(),
+	which throws std::bad_alloc, so going over the budget can't go unnoticed. The memory itself is never freed
+	by the resource. Needs C++17 and <memory_resource> (JOINTPOINTERMATH_HAS_PMR).
+
+		JointPointer_t Elems[] = { JointPointer(&Header, sizeof(Header_t)), JointPointer(&Names, 4096) };
+		void* Buffer = JointPointerAllocate(&TotalSize, malloc, Elems);
+		JointMemoryResource NameResource(Elems[1]);
+		std::pmr::vector<std::pmr::string> NameList(&NameResource);
+
+
+template<size_t N, size_t Align = std::alignment_of<std::max_align_t>::value> struct JointInline;
+void* JointInline::Allocate(size_t Size, size_t Alignment);
+void JointInline::Reset();
+template<size_t N, size_t Align = std::alignment_of<std::max_align_t>::value> struct JointSmallBlock;
+void* JointSmallBlock::Allocate(size_t Size, size_t Alignment);
+bool JointSmallBlock::IsInline() const;
+
+	Storage for short-lived layouts that don't need to touch the heap. Both are passed as the allocator.
+	JointInline is N bytes aligned to Align, meant to live on the stack. Allocate hands out its bytes in order
+	and returns null once they run out or the alignment is more than Align; Reset makes them all available again.
+	JointSmallBlock owns one buffer: it uses its own N bytes when the layout fits in them at the right
+	alignment, and JointAlignedMalloc otherwise, and frees the heap buffer (if any) when it is destroyed or asked
+	for another one. Neither can be copied or moved, since the pointers that were written point into them.
+
+		JointSmallBlock<256> Scratch;
+		JointPointerAllocate(nullptr, Scratch, { JointPointer(&Keys, sizeof(int) * NumKeys), JointPointer(&Flags, NumKeys) });
+		// Keys and Flags are on the stack if they fit, and on the heap otherwise.
+
+
+struct JointLayoutBuilder;
+void JointLayoutBuilder::Reserve(size_t Num);
+template<typename T> JointLayoutBuilder& JointLayoutBuilder::Add(T** Ptr, size_t Count);
+template<typename T> JointLayoutBuilder& JointLayoutBuilder::Add(T** Ptr, size_t Count, size_t Align, unsigned int Flags = 0);
+JointLayoutBuilder& JointLayoutBuilder::Add(const JointPointer_t& Elem);
+size_t JointLayoutBuilder::TotalSize();
+size_t JointLayoutBuilder::Alignment();
+bool JointLayoutBuilder::Overflowed() const;
+void JointLayoutBuilder::Write(void* Memory);
+template<typename AllocT> void* JointLayoutBuilder::Allocate(size_t* OutSize, AllocT&& Alloc);
+
+	Builds a layout one section at a time, for layouts with a number of sections only known at run time
+	(one per material, per bone, ...). Add takes an element count rather than a size, and every size and offset
+	is checked for overflow: if any of them doesn't fit in a size_t, Overflowed() returns true, TotalSize()
+	returns 0 and Allocate returns null without calling the allocator.
+	The offsets are computed with one mask-and-add per section, over alignment masks and sizes worked out when the
+	sections are added, and only for the sections added since the last time, so adding more sections after
+	TotalSize() or Allocate() is cheap. Data() and Offset(i) give the laid out sections.
+
+		JointLayoutBuilder Builder;
+		Builder.Reserve(NumMaterials);
+		for (size_t i=0; i <NumMaterials; i++)
+		{
+			Builder.Add(&Materials[i].Params, Materials[i].NumParams);
+		}
+		void* Buffer = Builder.Allocate(&TotalSize, malloc);
+
+
+#define JOINTPOINTERMATH_STATS 1
+void JointStatsAllocate(size_t TotalSize, size_t NumSections, size_t Payload);
+void JointStatsFree(size_t TotalSize);
+struct JointStatsTagScope;
+JointStatsTagScope::JointStatsTagScope(const char* Tag);
+enum JointStatsFormat { JOINTPOINTER_STATS_TEXT, JOINTPOINTER_STATS_PROMETHEUS };
+bool JointStatsDump(FILE* File, JointStatsFormat Format = JOINTPOINTER_STATS_TEXT);
+bool JointStatsDump(const char* Path, JointStatsFormat Format = JOINTPOINTER_STATS_TEXT);
+
+	Counts the joint blocks made by every allocating function and by the pools: allocations, frees, live blocks,
+	live and peak bytes, bytes lost to alignment padding, and histograms of block sizes and section counts.
+	The counters are relaxed atomics, kept once for the whole process and once per tag; a JointStatsTagScope
+	sends this thread's blocks to its tag until it goes out of scope, and blocks made outside any scope go to
+	"untagged". Frees are counted by the pools, JointPointerReallocate, JointPointerFree,
+	JointPointerFreeWithHeader and the JointMake blocks. Report a block released any other way (free, an arena
+	Reset, ...) with JointStatsFree(TotalSize), on the thread and under the tag that allocated it; calling it for a
+	block freed through one of the above counts the free twice.
+	JointStatsDump writes everything as text, or in the Prometheus exposition format for a node exporter's
+	textfile collector, and returns false on error. With JOINTPOINTERMATH_STATS 0, the default, the hooks
+	compile to nothing, the functions are empty and JointStatsDump returns false.
+
+		{
+			JointStatsTagScope Tag("meshes");
+			Mesh = JointPointerAllocate(&MeshSize, malloc, { JointPointer(&Vertices, VertexBytes), JointPointer(&Indices, IndexBytes) });
+		}
+		JointStatsDump("/var/lib/node_exporter/jointpointer.prom", JOINTPOINTER_STATS_PROMETHEUS);
+
+
+#define JOINTPOINTERMATH_TRACE 1
+enum JointTracePhase { JOINTPOINTER_TRACE_LAYOUT, JOINTPOINTER_TRACE_ALLOCATE, JOINTPOINTER_TRACE_WRITE };
+uint64_t JointTraceNow();
+double JointTraceTicksPerNanosecond();
+JointTraceSummary_t JointTraceSummarise(JointTracePhase Phase);
+bool JointTraceDump(FILE* File);
+
+	Times the three phases of JointPointerAllocate, JointPointerAllocatePacked and the JointLayoutPlan overloads:
+	working out the layout, the call to the allocator, and writing the pointers. The phases are read with
+	rdtsc on x86 and the virtual counter on ARM64 (steady_clock elsewhere), and go into log-linear histograms
+	kept per thread, which only their thread writes, so recording takes no locks or atomic adds. A thread's
+	histogram is folded into a shared one when it exits. JointTraceSummarise merges them into a count, p50,
+	p90, p99, p99.9 and max in ticks; JointTraceDump prints the same in nanoseconds.
+	Where <sys/sdt.h> exists (systemtap-sdt-dev), every traced allocation also fires the USDT probe
+	jointpointer:allocate(Memory, TotalSize, Num, LayoutTicks, AllocateTicks, WriteTicks), and JointPointerFree
+	fires jointpointer:free(Memory, TotalSize); each costs a nop until a tracer attaches. With JOINTPOINTERMATH_TRACE 0, the default, none of this is compiled in.
+
+		bpftrace -e 'usdt:./game:jointpointer:allocate { @allocate = hist(arg4); }'
+
+
+template<typename... Ts, typename... CountTs> std::tuple<JointBlock<JointAlignedFreer>, JointSpan<Ts>...> JointMake(CountTs... NumElems);
+template<typename... Ts, typename AllocT, typename FreeT, typename... CountTs> std::tuple<JointBlock<FreeT>, JointSpan<Ts>...> JointMake(AllocT&& Alloc, FreeT&& Free, CountTs... NumElems);
+template<typename FreeT = JointAlignedFreer> struct JointBlock;
+template<typename T, size_t Align = std::alignment_of<T>::value> struct JointSpan;
+template<typename T, size_t Align> struct JointAligned;
+template<size_t Align, typename T> T* JointAssumeAligned(T* Ptr);
+
+	Typed allocation without declaring pointers first or passing void** around: JointMake lays out NumElems[i]
+	elements of each type in Ts and returns a tuple of the owning block and one JointSpan per section.
+	The block is move-only, and frees the memory with Free when destroyed (JointAlignedFree for the first form);
+	a Free with no state, like JointAlignedFreer or a lambda without captures, takes no room, so the block is the
+	size of a pointer. When Free is a sized deallocator (anything JointPointerFree takes that is given the size),
+	or JOINTPOINTERMATH_STATS or JOINTPOINTERMATH_TRACE is on, the block also keeps the size and alignment, has
+	Size() and Alignment(), and frees through JointPointerFree, so the deallocator, the stats and the tracing all
+	get the size. Data(), begin() and indexing of a JointSpan go through JointAssumeAligned, which uses
+	std::assume_aligned or __builtin_assume_aligned, so the compiler knows each section's alignment when
+	vectorizing; write JointAligned<T, 32> in place of T to align a section to more than T needs. Copying
+	Data() into a local T* __restrict tells it the sections don't overlap as well. If a size overflows or the
+	allocator fails, the block is null and every span is empty. Alloc is any allocator JointPointerAllocate takes.
+
+		auto [Block, Verts, Indices] = JointMake<vec3, uint16_t>(malloc, free, NumVerts, NumIndices);
+		for (vec3& V : Verts) ...
+
+
+template<typename FreeT> void JointPointerFree(FreeT&& Free, void* Memory, int Num, const JointPointer_t* Elems);
+template<typename FreeT, int Num> void JointPointerFree(FreeT&& Free, void* Memory, const JointPointer_t (&Arr)[Num]);
+template<typename FreeT> void JointPointerFree(FreeT&& Free, void* Memory, size_t Size, size_t Alignment);
+template<typename FreeT> void JointDeallocatorFree(FreeT&& Free, void* Memory, size_t Size, size_t Alignment);
+void* JointNewAlloc(size_t Size, size_t Alignment);
+void JointNewFree(void* Memory, size_t Size, size_t Alignment);
+
+	Gives a block back to its allocator, with the size and alignment it was allocated with, so sized
+	deallocation can skip the size class lookup. Pass the Elems the block was allocated with (their offsets
+	give the size), or the size and alignment directly, which the init-list and batch allocations need.
+	A null Memory is ignored. Free is any of, in order of preference:
+		Free->deallocate(Memory, Size, Alignment)	a pointer to a memory resource
+		Free.deallocate(Memory, Size, Alignment)	a memory resource by reference
+		Free.deallocate(Pointer, Count)			a standard Allocator, the one that allocated the block
+		Free(Memory, Size, Alignment)			such as JointNewFree, or a wrapper around sdallocx
+		Free(Memory, Size)				such as free_sized
+		Free(Memory)					such as free
+	JointNewAlloc and JointNewFree are a pair over the aligned operator new and the sized, aligned operator
+	delete (JointAlignedMalloc and JointAlignedFree before C++17).
+
+		void* Buffer = JointPointerAllocate(&TotalSize, JointNewAlloc, Elems);
+		...
+		JointPointerFree(JointNewFree, Buffer, Elems);
+
+
+struct JointBlockHeader_t { uint64_t TotalSize; uint32_t Alignment; uint32_t LayoutId; };
+template<typename AllocT> void* JointPointerAllocateWithHeader(size_t* OutSize, AllocT&& Alloc, uint32_t LayoutId, int Num, JointPointer_t* Elems);
+template<typename AllocT, int Num> void* JointPointerAllocateWithHeader(size_t* OutSize, AllocT&& Alloc, uint32_t LayoutId, JointPointer_t (&Arr)[Num]);
+const JointBlockHeader_t* JointPointerHeader(const void* Memory);
+template<typename FreeT> void JointPointerFreeWithHeader(FreeT&& Free, void* Memory);
+
+	Same as JointPointerAllocate, but with a 16 byte header just before the first section that records the
+	layout's size and alignment and a LayoutId of your choosing, for freeing the block without knowing its
+	layout and for working out what a block is from a pointer to it (in a debugger, a heap walk, ...).
+	The header is padded up to the block's alignment, so the first section stays aligned, and OutSize does
+	not count it. JointPointerHeader reads it back; JointPointerFreeWithHeader frees the whole block through
+	JointPointerFree. Only use these two on blocks from JointPointerAllocateWithHeader.
+
+
 Version history:
 ================
 
 
 September 24, 2014 - first draft.
+October 16, 2026 - breaking change: allocators can be any callable or allocator object, and aligned allocators are
+	now always called as Alloc(Size, Alignment). The JointPointerAllocate overload taking int Num and an array used
+	to call Alloc(Alignment, Size), the memalign order; code that passed memalign (or anything else with that order)
+	there now gets its arguments swapped, so wrap it:
+		[](size_t Size, size_t Alignment) { return memalign(Alignment, Size); }
+	aligned_alloc also takes (Alignment, Size) and needs the same wrapper; JointAlignedMalloc already has the new
+	order. Aligned allocators are also given the largest alignment of any section rather than the first one's.
 */
 
 #ifndef JOINT_POINTER_MATH_H
@@ -96,9 +625,160 @@ September 24, 2014 - first draft.
 #define JOINTPOINTERMATH_ASSERT(x) assert(x)
 //#define JOINTPOINTERMATH_ASSERT(x) do {} while(0)
 
+#include <atomic>
+#include <cstddef>
 #include <initializer_list>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define JOINTPOINTERMATH_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define JOINTPOINTERMATH_HAS_MMAP 0
+#endif
+#if defined(__has_include) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#if __has_include(<memory_resource>)
+#define JOINTPOINTERMATH_HAS_PMR 1
+#include <memory_resource>
+#endif
+#endif
+#ifndef JOINTPOINTERMATH_HAS_PMR
+#define JOINTPOINTERMATH_HAS_PMR 0
+#endif
+
+// Set to 1 to count every joint block allocated and freed, see JointStatsDump. Off by default, which leaves no trace in the allocation paths.
+#ifndef JOINTPOINTERMATH_STATS
+#define JOINTPOINTERMATH_STATS 0
+#endif
+
+// Set to 1 to time the phases of each allocation, see JointTraceDump, and to fire USDT probes where <sys/sdt.h> exists.
+#ifndef JOINTPOINTERMATH_TRACE
+#define JOINTPOINTERMATH_TRACE 0
+#endif
+#if JOINTPOINTERMATH_TRACE
+#include <chrono>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define JOINTPOINTERMATH_HAS_SDT 1
+#include <sys/sdt.h>
+#endif
+#endif
+#endif
+#ifndef JOINTPOINTERMATH_HAS_SDT
+#define JOINTPOINTERMATH_HAS_SDT 0
+#endif
+
+#ifndef JOINTPOINTERMATH_ARENA_CHUNK_SIZE
+#define JOINTPOINTERMATH_ARENA_CHUNK_SIZE (64 * 1024)
+#endif
+
+// Number of per-layout slots in each thread's JointPool cache, and the number of buffers each slot holds.
+#ifndef JOINTPOINTERMATH_POOL_CACHE_SLOTS
+#define JOINTPOINTERMATH_POOL_CACHE_SLOTS 16
+#endif
+#ifndef JOINTPOINTERMATH_POOL_MAGAZINE_SIZE
+#define JOINTPOINTERMATH_POOL_MAGAZINE_SIZE 32
+#endif
+
+// Destructive interference size: the distance two things written by different threads must be apart to
+// not share a cache line. Apple's arm64 chips and POWER have 128 byte lines.
+#ifndef JOINTPOINTERMATH_CACHE_LINE_SIZE
+#if (defined(__APPLE__) && defined(__aarch64__)) || defined(__powerpc64__)
+#define JOINTPOINTERMATH_CACHE_LINE_SIZE 128
+#else
+#define JOINTPOINTERMATH_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+// When 1, every section is treated as if it had JOINTPOINTER_EXCLUSIVE_LINE.
+#ifndef JOINTPOINTERMATH_EXCLUSIVE_LINES
+#define JOINTPOINTERMATH_EXCLUSIVE_LINES 0
+#endif
+
+// Vector width every section is padded to, as if it had the matching JOINTPOINTER_PAD_ flag. 0 for none.
+#ifndef JOINTPOINTERMATH_SIMD_PAD
+#define JOINTPOINTERMATH_SIMD_PAD 0
+#endif
+
+// Number of freed buffers a JointConcurrentPool keeps on each CPU's stack before sharing them.
+#ifndef JOINTPOINTERMATH_CONCURRENT_POOL_CPU_CAPACITY
+#define JOINTPOINTERMATH_CONCURRENT_POOL_CPU_CAPACITY 256
+#endif
+
+#ifndef JOINTPOINTERMATH_HUGE_PAGE_SIZE
+#define JOINTPOINTERMATH_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+#ifndef JOINTPOINTERMATH_MAP_DEFAULT_FLAGS
+#define JOINTPOINTERMATH_MAP_DEFAULT_FLAGS JOINTPOINTER_MAP_HUGEPAGES
+#endif
+
+#ifndef JOINTPOINTERMATH_NUMA_MAX_NODES
+#define JOINTPOINTERMATH_NUMA_MAX_NODES 1024
+#endif
+
+#define JOINTPOINTERMATH_IMAGE_MAGIC 0x494d504au // "JPMI" when read as bytes on a little endian machine.
+#define JOINTPOINTERMATH_IMAGE_VERSION 1
+#ifndef JOINTPOINTERMATH_IMAGE_NAME_SIZE
+#define JOINTPOINTERMATH_IMAGE_NAME_SIZE 40
+#endif
+#ifndef JOINTPOINTERMATH_IMAGE_DATA_ALIGNMENT
+#define JOINTPOINTERMATH_IMAGE_DATA_ALIGNMENT 4096
+#endif
+
+enum JointPointerFlags
+{
+	JOINTPOINTER_PINNED = 1 << 0, // Keep this section in its declared position when packing.
+	JOINTPOINTER_EXCLUSIVE_LINE = 1 << 1, // Give this section cache lines of its own.
+	JOINTPOINTER_PAD_16 = 1 << 2, // Align this section to 16 bytes, round its size up to a multiple of 16 and add 16 bytes of slack.
+	JOINTPOINTER_PAD_32 = 1 << 3, // Same for 32 bytes.
+	JOINTPOINTER_PAD_64 = 1 << 4, // Same for 64 bytes.
+};
+
+enum JointMapFlags
+{
+	JOINTPOINTER_MAP_HUGEPAGES = 1 << 0,
+	JOINTPOINTER_MAP_HUGETLB = 1 << 1,
+	JOINTPOINTER_MAP_POPULATE = 1 << 2,
+	JOINTPOINTER_MAP_LOCK = 1 << 3,
+};
+
+enum JointNumaNode
+{
+	JOINTPOINTER_NUMA_LOCAL = -1,
+	JOINTPOINTER_NUMA_INTERLEAVE = -2,
+};
 
 struct JointPointer_t
 {
@@ -106,15 +786,25 @@ struct JointPointer_t
 	size_t Size;
 	size_t Alignment;
 	size_t Offset;
+	unsigned int Flags;
 
-	JointPointer_t(){}
+	// Fields can be set one by one after this; Flags stays 0 unless set.
+	JointPointer_t()
+	{
+		Pointer = nullptr;
+		Size = 0;
+		Alignment = 1;
+		Offset = 0;
+		Flags = 0;
+	}
 
-	JointPointer_t(void** P, size_t Sz, size_t Align)
+	JointPointer_t(void** P, size_t Sz, size_t Align, unsigned int F = 0)
 	{
 		Pointer = P;
 		Size = Sz;
 		Alignment = Align;
 		Offset = 0;
+		Flags = F;
 	}
 };
 
@@ -130,6 +820,74 @@ template<typename T> JointPointer_t JointPointer(T** Ptr, size_t Sz)
 	return JointPointer_t((void**) Ptr, Sz, std::alignment_of<T>::value);
 }
 
+template<typename T> JointPointer_t JointPointer(T** Ptr, size_t Sz, size_t Align, unsigned int Flags)
+{
+	JOINTPOINTERMATH_ASSERT(Ptr != nullptr);
+	return JointPointer_t((void**) Ptr, Sz, Align, Flags);
+}
+
+constexpr size_t JointAlignUp(size_t Offset, size_t Align)
+{
+	return (Offset + (Align - 1)) & ~(Align - 1);
+}
+
+inline bool JointPointerIsExclusive(const JointPointer_t& Elem)
+{
+	return JOINTPOINTERMATH_EXCLUSIVE_LINES || (Elem.Flags & JOINTPOINTER_EXCLUSIVE_LINE) != 0;
+}
+
+inline size_t JointPointerPaddingOf(const JointPointer_t& Elem)
+{
+	static_assert((JOINTPOINTERMATH_SIMD_PAD & (JOINTPOINTERMATH_SIMD_PAD - 1)) == 0, "JOINTPOINTERMATH_SIMD_PAD must be 0 or a power of two");
+	size_t Padding = JOINTPOINTERMATH_SIMD_PAD;
+	if ((Elem.Flags & JOINTPOINTER_PAD_64) != 0 && Padding < 64)
+	{
+		Padding = 64;
+	}
+	else if ((Elem.Flags & JOINTPOINTER_PAD_32) != 0 && Padding < 32)
+	{
+		Padding = 32;
+	}
+	else if ((Elem.Flags & JOINTPOINTER_PAD_16) != 0 && Padding < 16)
+	{
+		Padding = 16;
+	}
+	return Padding;
+}
+
+// The bytes a padded section takes before any cache line rounding: its size rounded up to the vector width, plus
+// one more vector of slack, so a full vector read or written from anywhere inside the section stays inside it.
+inline size_t JointPointerPaddedSize(const JointPointer_t& Elem)
+{
+	size_t Padding = JointPointerPaddingOf(Elem);
+	return Padding != 0 ? JointAlignUp(Elem.Size, Padding) + Padding : Elem.Size;
+}
+
+// The alignment and the number of bytes a section really takes up in the buffer, including what the flags add.
+inline size_t JointPointerAlignmentOf(const JointPointer_t& Elem)
+{
+	size_t Alignment = Elem.Alignment;
+	if (JointPointerPaddingOf(Elem) > Alignment)
+	{
+		Alignment = JointPointerPaddingOf(Elem);
+	}
+	if (JointPointerIsExclusive(Elem) && Alignment < JOINTPOINTERMATH_CACHE_LINE_SIZE)
+	{
+		Alignment = JOINTPOINTERMATH_CACHE_LINE_SIZE;
+	}
+	return Alignment;
+}
+
+inline size_t JointPointerExtentOf(const JointPointer_t& Elem)
+{
+	size_t Extent = JointPointerPaddedSize(Elem);
+	if (JointPointerIsExclusive(Elem))
+	{
+		Extent = JointAlignUp(Extent, JOINTPOINTERMATH_CACHE_LINE_SIZE);
+	}
+	return Extent;
+}
+
 inline size_t JointPointerTotalSize(int Num, JointPointer_t* Elems)
 {
 	JOINTPOINTERMATH_ASSERT(Num > 0);
@@ -138,9 +896,9 @@ inline size_t JointPointerTotalSize(int Num, JointPointer_t* Elems)
 	for (int i=0; i <Num; i++)
 	{
 		size_t Ignore = std::numeric_limits<std::size_t>::max();
-		Ptr = std::align(Elems[i].Alignment, Elems[i].Size, Ptr, Ignore);
+		Ptr = std::align(JointPointerAlignmentOf(Elems[i]), JointPointerExtentOf(Elems[i]), Ptr, Ignore);
 		Elems[i].Offset = (size_t)Ptr;
-		Ptr = ((char*)Ptr) + Elems[i].Size;
+		Ptr = ((char*)Ptr) + JointPointerExtentOf(Elems[i]);
 	}
 	return (size_t)Ptr;
 }
@@ -151,116 +909,3686 @@ template<int Num> size_t JointPointerTotalSize(JointPointer_t (&Arr)[Num])
 	return JointPointerTotalSize(Num, Arr);
 }
 
-inline void JointPointerWrite(void* Memory, int Num, JointPointer_t* Elems)
+inline unsigned int JointLog2(uint64_t Value)
 {
-	JOINTPOINTERMATH_ASSERT(Num > 0);
-	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
-	for (int i=0; i <Num; i++)
+	JOINTPOINTERMATH_ASSERT(Value != 0);
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(Value);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long Index;
+	_BitScanReverse64(&Index, Value);
+	return Index;
+#else
+	unsigned int Index = 0;
+	while (Value >>= 1)
 	{
-		*Elems[i].Pointer = ((char*)Memory) + Elems[i].Offset;
+		Index++;
 	}
+	return Index;
+#endif
 }
 
-inline void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t Size), int Num, JointPointer_t* Elems)
+#if JOINTPOINTERMATH_STATS
+// Bucket i of the histograms counts values in (2^(i-1), 2^i]; the last bucket also takes everything bigger.
+#define JOINTPOINTERMATH_STATS_SIZE_BUCKETS 48
+#define JOINTPOINTERMATH_STATS_SECTION_BUCKETS 17
+
+struct JointStatsCounters_t
 {
-	JOINTPOINTERMATH_ASSERT(Num > 0);
-	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
-	size_t TotalSize = JointPointerTotalSize(Num, Elems);
-	if (OutSize != nullptr)
+	std::string Tag;
+	std::atomic<uint64_t> Allocations;
+	std::atomic<uint64_t> Frees;
+	std::atomic<int64_t> LiveBytes;
+	std::atomic<int64_t> PeakBytes;
+	std::atomic<uint64_t> AllocatedBytes;
+	std::atomic<uint64_t> PaddingBytes;
+	std::atomic<uint64_t> Sections;
+	std::atomic<uint64_t> SizeHistogram[JOINTPOINTERMATH_STATS_SIZE_BUCKETS];
+	std::atomic<uint64_t> SectionHistogram[JOINTPOINTERMATH_STATS_SECTION_BUCKETS];
+
+	explicit JointStatsCounters_t(const char* Name) : Tag(Name), Allocations(0), Frees(0), LiveBytes(0), PeakBytes(0), AllocatedBytes(0), PaddingBytes(0), Sections(0)
 	{
-		*OutSize = TotalSize;
+		for (int i=0; i <JOINTPOINTERMATH_STATS_SIZE_BUCKETS; i++)
+		{
+			SizeHistogram[i].store(0, std::memory_order_relaxed);
+		}
+		for (int i=0; i <JOINTPOINTERMATH_STATS_SECTION_BUCKETS; i++)
+		{
+			SectionHistogram[i].store(0, std::memory_order_relaxed);
+		}
 	}
-	void* Memory = Alloc(TotalSize);
-	JointPointerWrite(Memory, Num, Elems);
-	return Memory;
-}
+};
 
-inline void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t Size, size_t Alignment), int Num, JointPointer_t* Elems)
+struct JointStatsRegistry_t
 {
-	JOINTPOINTERMATH_ASSERT(Num > 0);
-	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
-	size_t TotalSize = JointPointerTotalSize(Num, Elems);
-	if (OutSize != nullptr)
+	std::mutex Mutex;
+	std::vector<JointStatsCounters_t*> Tags; // Never freed, so pointers to them stay valid.
+	JointStatsCounters_t All;
+	JointStatsCounters_t Untagged;
+
+	JointStatsRegistry_t() : All("all"), Untagged("untagged")
 	{
-		*OutSize = TotalSize;
+		Tags.push_back(&Untagged);
 	}
-	void* Memory = Alloc(Elems[0].Alignment, TotalSize);
-	JointPointerWrite(Memory, Num, Elems);
-	return Memory;
-}
+};
 
-template<int Num> void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size), JointPointer_t (&Arr)[Num])
+inline JointStatsRegistry_t& JointStatsRegistry()
 {
-	return JointPointerAllocate(OutSize, Alloc, Num, Arr);
+	// Never destroyed, so blocks freed by static destructors can still be counted.
+	static JointStatsRegistry_t* Registry = new JointStatsRegistry_t();
+	return *Registry;
 }
 
-template<int Num> void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size, size_t alignment), JointPointer_t (&Arr)[Num])
+inline JointStatsCounters_t*& JointStatsCurrentTag()
 {
-	return JointPointerAllocate(OutSize, Alloc, Num, Arr);
+	static thread_local JointStatsCounters_t* Current = nullptr;
+	return Current;
 }
 
-inline void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size), std::initializer_list<JointPointer_t> ini)
+inline JointStatsCounters_t* JointStatsFindTag(const char* Tag)
 {
-	JOINTPOINTERMATH_ASSERT(ini.size() > 0);
-
-	// Determine total size.
-	void* Ptr = 0;
-	for (const JointPointer_t& JP : ini)
+	JointStatsRegistry_t& Registry = JointStatsRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	for (JointStatsCounters_t* Counters : Registry.Tags)
 	{
-		size_t Ignore = std::numeric_limits<std::size_t>::max();
-		Ptr = std::align(JP.Alignment, JP.Size, Ptr, Ignore);
-		Ptr = ((char*)Ptr) + JP.Size;
+		if (Counters->Tag == Tag)
+		{
+			return Counters;
+		}
 	}
-	size_t TotalSize = (size_t)Ptr;
-	if (OutSize != nullptr)
+	Registry.Tags.push_back(new JointStatsCounters_t(Tag));
+	return Registry.Tags.back();
+}
+
+inline int JointStatsBucket(uint64_t Value, int NumBuckets)
+{
+	int Bucket = 0;
+	while (Bucket < NumBuckets - 1 && (1ull << Bucket) < Value)
 	{
-		*OutSize = TotalSize;
+		Bucket++;
 	}
+	return Bucket;
+}
 
-	void* Memory = Alloc(TotalSize);
-
-	// Write pointers.
-	Ptr = 0;
-	for (const JointPointer_t& JP : ini)
+inline void JointStatsAdd(JointStatsCounters_t& Counters, size_t TotalSize, size_t NumSections, size_t Payload)
+{
+	Counters.Allocations.fetch_add(1, std::memory_order_relaxed);
+	Counters.AllocatedBytes.fetch_add(TotalSize, std::memory_order_relaxed);
+	Counters.PaddingBytes.fetch_add(TotalSize > Payload ? TotalSize - Payload : 0, std::memory_order_relaxed);
+	Counters.Sections.fetch_add(NumSections, std::memory_order_relaxed);
+	Counters.SizeHistogram[JointStatsBucket(TotalSize, JOINTPOINTERMATH_STATS_SIZE_BUCKETS)].fetch_add(1, std::memory_order_relaxed);
+	Counters.SectionHistogram[JointStatsBucket(NumSections, JOINTPOINTERMATH_STATS_SECTION_BUCKETS)].fetch_add(1, std::memory_order_relaxed);
+	int64_t Live = Counters.LiveBytes.fetch_add((int64_t)TotalSize, std::memory_order_relaxed) + (int64_t)TotalSize;
+	int64_t Peak = Counters.PeakBytes.load(std::memory_order_relaxed);
+	while (Live > Peak && !Counters.PeakBytes.compare_exchange_weak(Peak, Live, std::memory_order_relaxed))
 	{
-		size_t Ignore = std::numeric_limits<std::size_t>::max();
-		Ptr = std::align(JP.Alignment, JP.Size, Ptr, Ignore);
-		*JP.Pointer = (char*)Memory + (size_t)Ptr;
-		Ptr = ((char*)Ptr) + JP.Size;
 	}
-	return Memory;
 }
 
-inline void* JointPointerAllocate(size_t* OutSize, void* (*Alloc)(size_t size, size_t alignment), std::initializer_list<JointPointer_t> ini)
+inline void JointStatsRemove(JointStatsCounters_t& Counters, size_t TotalSize)
 {
-	JOINTPOINTERMATH_ASSERT(ini.size() > 0);
+	Counters.Frees.fetch_add(1, std::memory_order_relaxed);
+	Counters.LiveBytes.fetch_sub((int64_t)TotalSize, std::memory_order_relaxed);
+}
+#endif
 
-	// Determine total size.
-	void* Ptr = 0;
-	for (const JointPointer_t& JP : ini)
+// Counts a joint block of TotalSize bytes holding NumSections sections of Payload bytes in all.
+inline void JointStatsAllocate(size_t TotalSize, size_t NumSections, size_t Payload)
+{
+#if JOINTPOINTERMATH_STATS
+	JointStatsCounters_t* Tag = JointStatsCurrentTag();
+	JointStatsAdd(JointStatsRegistry().All, TotalSize, NumSections, Payload);
+	JointStatsAdd(Tag != nullptr ? *Tag : JointStatsRegistry().Untagged, TotalSize, NumSections, Payload);
+#else
+	(void)TotalSize;
+	(void)NumSections;
+	(void)Payload;
+#endif
+}
+
+inline void JointStatsFree(size_t TotalSize)
+{
+#if JOINTPOINTERMATH_STATS
+	JointStatsCounters_t* Tag = JointStatsCurrentTag();
+	JointStatsRemove(JointStatsRegistry().All, TotalSize);
+	JointStatsRemove(Tag != nullptr ? *Tag : JointStatsRegistry().Untagged, TotalSize);
+#else
+	(void)TotalSize;
+#endif
+}
+
+inline size_t JointStatsPayload(int Num, const JointPointer_t* Elems)
+{
+	size_t Payload = 0;
+	for (int i=0; i <Num; i++)
 	{
-		size_t Ignore = std::numeric_limits<std::size_t>::max();
-		Ptr = std::align(JP.Alignment, JP.Size, Ptr, Ignore);
-		Ptr = ((char*)Ptr) + JP.Size;
+		Payload += Elems[i].Size;
+	}
+	return Payload;
+}
+
+inline size_t JointStatsPayload(std::initializer_list<JointPointer_t> ini)
+{
+	return JointStatsPayload((int)ini.size(), ini.begin());
+}
+
+inline size_t JointStatsSum(std::initializer_list<size_t> Sizes)
+{
+	size_t Sum = 0;
+	for (size_t Size : Sizes)
+	{
+		Sum += Size;
+	}
+	return Sum;
+}
+
+// The hooks the allocating functions use. When stats are off they expand to nothing, and their arguments,
+// some of which loop over the sections, are never evaluated.
+#if JOINTPOINTERMATH_STATS
+#define JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, NumSections, Payload) do { if ((Memory) != nullptr) { JointStatsAllocate((TotalSize), (NumSections), (Payload)); } } while (0)
+#define JOINTPOINTERMATH_STATS_FREE(Memory, TotalSize) do { if ((Memory) != nullptr) { JointStatsFree(TotalSize); } } while (0)
+#else
+#define JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, NumSections, Payload) ((void)0)
+#define JOINTPOINTERMATH_STATS_FREE(Memory, TotalSize) ((void)0)
+#endif
+
+// Attributes the allocations and frees made by this thread to Tag while in scope. Tag is copied.
+struct JointStatsTagScope
+{
+#if JOINTPOINTERMATH_STATS
+	JointStatsCounters_t* Previous;
+
+	explicit JointStatsTagScope(const char* Tag)
+	{
+		Previous = JointStatsCurrentTag();
+		JointStatsCurrentTag() = JointStatsFindTag(Tag);
+	}
+
+	~JointStatsTagScope()
+	{
+		JointStatsCurrentTag() = Previous;
+	}
+#else
+	explicit JointStatsTagScope(const char*)
+	{
+	}
+#endif
+
+	JointStatsTagScope(const JointStatsTagScope&) = delete;
+	JointStatsTagScope& operator=(const JointStatsTagScope&) = delete;
+};
+
+enum JointStatsFormat
+{
+	JOINTPOINTER_STATS_TEXT,
+	JOINTPOINTER_STATS_PROMETHEUS,
+};
+
+#if JOINTPOINTERMATH_STATS
+inline void JointStatsDumpText(FILE* File, const JointStatsCounters_t& Counters)
+{
+	uint64_t Allocations = Counters.Allocations.load(std::memory_order_relaxed);
+	uint64_t Frees = Counters.Frees.load(std::memory_order_relaxed);
+	uint64_t Allocated = Counters.AllocatedBytes.load(std::memory_order_relaxed);
+	uint64_t Padding = Counters.PaddingBytes.load(std::memory_order_relaxed);
+	fprintf(File, "%s:\n", Counters.Tag.c_str());
+	fprintf(File, "\tallocations %llu, frees %llu, live blocks %lld\n", (unsigned long long)Allocations, (unsigned long long)Frees, (long long)(Allocations - Frees));
+	fprintf(File, "\tlive bytes %lld, peak bytes %lld, allocated bytes %llu\n", (long long)Counters.LiveBytes.load(std::memory_order_relaxed),
+		(long long)Counters.PeakBytes.load(std::memory_order_relaxed), (unsigned long long)Allocated);
+	fprintf(File, "\tpadding bytes %llu (%.2f%%), sections %llu\n", (unsigned long long)Padding, Allocated > 0 ? 100.0 * (double)Padding / (double)Allocated : 0.0,
+		(unsigned long long)Counters.Sections.load(std::memory_order_relaxed));
+	fprintf(File, "\tblock size:");
+	for (int i=0; i <JOINTPOINTERMATH_STATS_SIZE_BUCKETS; i++)
+	{
+		uint64_t Count = Counters.SizeHistogram[i].load(std::memory_order_relaxed);
+		if (Count != 0)
+		{
+			fprintf(File, " <=%llu: %llu", 1ull << i, (unsigned long long)Count);
+		}
+	}
+	fprintf(File, "\n\tsections:");
+	for (int i=0; i <JOINTPOINTERMATH_STATS_SECTION_BUCKETS; i++)
+	{
+		uint64_t Count = Counters.SectionHistogram[i].load(std::memory_order_relaxed);
+		if (Count != 0)
+		{
+			fprintf(File, " <=%llu: %llu", 1ull << i, (unsigned long long)Count);
+		}
+	}
+	fprintf(File, "\n");
+}
+
+inline void JointStatsDumpHistogram(FILE* File, const char* Name, const char* Tag, const std::atomic<uint64_t>* Buckets, int NumBuckets, uint64_t Sum, uint64_t Count)
+{
+	uint64_t Cumulative = 0;
+	for (int i=0; i <NumBuckets - 1; i++)
+	{
+		Cumulative += Buckets[i].load(std::memory_order_relaxed);
+		fprintf(File, "%s_bucket{tag=\"%s\",le=\"%llu\"} %llu\n", Name, Tag, 1ull << i, (unsigned long long)Cumulative);
+	}
+	fprintf(File, "%s_bucket{tag=\"%s\",le=\"+Inf\"} %llu\n", Name, Tag, (unsigned long long)Count);
+	fprintf(File, "%s_sum{tag=\"%s\"} %llu\n", Name, Tag, (unsigned long long)Sum);
+	fprintf(File, "%s_count{tag=\"%s\"} %llu\n", Name, Tag, (unsigned long long)Count);
+}
+
+// Tag names go inside quotes in the exposition format, so anything that would end the string is replaced.
+inline std::string JointStatsLabel(const std::string& Tag)
+{
+	std::string Label = Tag;
+	for (char& C : Label)
+	{
+		if (C == '"' || C == '\\' || C == '\n')
+		{
+			C = '_';
+		}
+	}
+	return Label;
+}
+
+inline void JointStatsDumpPrometheus(FILE* File, const JointStatsCounters_t& All, const std::vector<JointStatsCounters_t*>& Tags)
+{
+	struct Metric_t
+	{
+		const char* Name;
+		const char* Type;
+		const char* Help;
+	};
+	static const Metric_t Metrics[] =
+	{
+		{ "jointpointer_allocations_total", "counter", "Joint blocks allocated." },
+		{ "jointpointer_frees_total", "counter", "Joint blocks freed." },
+		{ "jointpointer_live_blocks", "gauge", "Joint blocks currently allocated." },
+		{ "jointpointer_live_bytes", "gauge", "Bytes in joint blocks currently allocated." },
+		{ "jointpointer_peak_bytes", "gauge", "Largest value live_bytes has had." },
+		{ "jointpointer_allocated_bytes_total", "counter", "Bytes of all joint blocks ever allocated." },
+		{ "jointpointer_padding_bytes_total", "counter", "Bytes of alignment padding in all joint blocks ever allocated." },
+	};
+	for (int m=0; m <(int)(sizeof(Metrics) / sizeof(Metrics[0])); m++)
+	{
+		fprintf(File, "# HELP %s %s\n# TYPE %s %s\n", Metrics[m].Name, Metrics[m].Help, Metrics[m].Name, Metrics[m].Type);
+		for (const JointStatsCounters_t* Counters : Tags)
+		{
+			uint64_t Allocations = Counters->Allocations.load(std::memory_order_relaxed);
+			uint64_t Frees = Counters->Frees.load(std::memory_order_relaxed);
+			long long Values[] =
+			{
+				(long long)Allocations,
+				(long long)Frees,
+				(long long)(Allocations - Frees),
+				(long long)Counters->LiveBytes.load(std::memory_order_relaxed),
+				(long long)Counters->PeakBytes.load(std::memory_order_relaxed),
+				(long long)Counters->AllocatedBytes.load(std::memory_order_relaxed),
+				(long long)Counters->PaddingBytes.load(std::memory_order_relaxed),
+			};
+			fprintf(File, "%s{tag=\"%s\"} %lld\n", Metrics[m].Name, JointStatsLabel(Counters->Tag).c_str(), Values[m]);
+		}
+	}
+	// The tags peak at different times, so the process peak is not the sum of theirs.
+	fprintf(File, "# HELP jointpointer_process_peak_bytes Largest number of bytes in joint blocks allocated at once, over all tags.\n");
+	fprintf(File, "# TYPE jointpointer_process_peak_bytes gauge\njointpointer_process_peak_bytes %lld\n", (long long)All.PeakBytes.load(std::memory_order_relaxed));
+	fprintf(File, "# HELP jointpointer_block_size_bytes Size of joint blocks.\n# TYPE jointpointer_block_size_bytes histogram\n");
+	for (const JointStatsCounters_t* Counters : Tags)
+	{
+		JointStatsDumpHistogram(File, "jointpointer_block_size_bytes", JointStatsLabel(Counters->Tag).c_str(), Counters->SizeHistogram, JOINTPOINTERMATH_STATS_SIZE_BUCKETS,
+			Counters->AllocatedBytes.load(std::memory_order_relaxed), Counters->Allocations.load(std::memory_order_relaxed));
+	}
+	fprintf(File, "# HELP jointpointer_block_sections Number of sections in joint blocks.\n# TYPE jointpointer_block_sections histogram\n");
+	for (const JointStatsCounters_t* Counters : Tags)
+	{
+		JointStatsDumpHistogram(File, "jointpointer_block_sections", JointStatsLabel(Counters->Tag).c_str(), Counters->SectionHistogram, JOINTPOINTERMATH_STATS_SECTION_BUCKETS,
+			Counters->Sections.load(std::memory_order_relaxed), Counters->Allocations.load(std::memory_order_relaxed));
+	}
+}
+#endif
+
+inline bool JointStatsDump(FILE* File, JointStatsFormat Format = JOINTPOINTER_STATS_TEXT)
+{
+	JOINTPOINTERMATH_ASSERT(File != nullptr);
+#if JOINTPOINTERMATH_STATS
+	JointStatsRegistry_t& Registry = JointStatsRegistry();
+	std::vector<JointStatsCounters_t*> Tags;
+	{
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		Tags = Registry.Tags;
+	}
+	if (Format == JOINTPOINTER_STATS_PROMETHEUS)
+	{
+		JointStatsDumpPrometheus(File, Registry.All, Tags);
+	}
+	else
+	{
+		JointStatsDumpText(File, Registry.All);
+		for (const JointStatsCounters_t* Counters : Tags)
+		{
+			JointStatsDumpText(File, *Counters);
+		}
+	}
+	return ferror(File) == 0;
+#else
+	(void)File;
+	(void)Format;
+	return false;
+#endif
+}
+
+inline bool JointStatsDump(const char* Path, JointStatsFormat Format = JOINTPOINTER_STATS_TEXT)
+{
+	JOINTPOINTERMATH_ASSERT(Path != nullptr);
+#if JOINTPOINTERMATH_STATS
+	FILE* File = fopen(Path, "w");
+	if (File == nullptr)
+	{
+		return false;
+	}
+	bool Written = JointStatsDump(File, Format);
+	return fclose(File) == 0 && Written;
+#else
+	(void)Path;
+	(void)Format;
+	return false;
+#endif
+}
+
+enum JointTracePhase
+{
+	JOINTPOINTER_TRACE_LAYOUT, // Working out the offsets and the total size.
+	JOINTPOINTER_TRACE_ALLOCATE, // The call to the allocator.
+	JOINTPOINTER_TRACE_WRITE, // Writing the pointers and clearing padding.
+	JOINTPOINTER_TRACE_PHASES,
+};
+
+#if JOINTPOINTERMATH_TRACE
+// Log-linear buckets: values below 16 get one each, and every power of two above that is split into 16,
+// which keeps each bucket within 6.25% of the values in it.
+#define JOINTPOINTERMATH_TRACE_SUB_BUCKETS 16
+#define JOINTPOINTERMATH_TRACE_BUCKETS (61 * JOINTPOINTERMATH_TRACE_SUB_BUCKETS)
+
+// Ticks of the cheapest clock there is: the time stamp counter on x86, the virtual counter on ARM64.
+// Neither is serializing, so a phase of a few ticks can be reordered into its neighbours.
+inline uint64_t JointTraceNow()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	return __rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	return __rdtsc();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+	uint64_t Ticks;
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(Ticks));
+	return Ticks;
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Measured once, over 20ms, the first time it is needed.
+inline double JointTraceTicksPerNanosecond()
+{
+	static const double TicksPerNs = []()
+	{
+		std::chrono::steady_clock::time_point Begin = std::chrono::steady_clock::now();
+		uint64_t BeginTicks = JointTraceNow();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		uint64_t EndTicks = JointTraceNow();
+		double Ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Begin).count();
+		return Ns > 0 ? (double)(EndTicks - BeginTicks) / Ns : 1.0;
+	}();
+	return TicksPerNs;
+}
+
+inline int JointTraceBucket(uint64_t Ticks)
+{
+	if (Ticks < JOINTPOINTERMATH_TRACE_SUB_BUCKETS)
+	{
+		return (int)Ticks;
+	}
+	int Exponent = (int)JointLog2(Ticks);
+	int Sub = (int)(Ticks >> (Exponent - 4)) & (JOINTPOINTERMATH_TRACE_SUB_BUCKETS - 1);
+	return (Exponent - 3) * JOINTPOINTERMATH_TRACE_SUB_BUCKETS + Sub;
+}
+
+// Smallest value that lands in Bucket.
+inline uint64_t JointTraceBucketStart(int Bucket)
+{
+	if (Bucket < JOINTPOINTERMATH_TRACE_SUB_BUCKETS)
+	{
+		return (uint64_t)Bucket;
+	}
+	int Exponent = Bucket / JOINTPOINTERMATH_TRACE_SUB_BUCKETS + 3;
+	int Sub = Bucket % JOINTPOINTERMATH_TRACE_SUB_BUCKETS;
+	return (uint64_t)(JOINTPOINTERMATH_TRACE_SUB_BUCKETS + Sub) << (Exponent - 4);
+}
+
+// Only the owning thread writes a histogram, with plain loads and stores rather than locked adds;
+// the atomics are there so JointTraceDump can read it while the thread runs.
+struct JointTraceHistogram_t
+{
+	std::atomic<uint64_t> Counts[JOINTPOINTER_TRACE_PHASES][JOINTPOINTERMATH_TRACE_BUCKETS];
+	std::atomic<uint64_t> Max[JOINTPOINTER_TRACE_PHASES];
+
+	JointTraceHistogram_t()
+	{
+		for (int p=0; p <JOINTPOINTER_TRACE_PHASES; p++)
+		{
+			for (int i=0; i <JOINTPOINTERMATH_TRACE_BUCKETS; i++)
+			{
+				Counts[p][i].store(0, std::memory_order_relaxed);
+			}
+			Max[p].store(0, std::memory_order_relaxed);
+		}
+	}
+};
+
+struct JointTraceRegistry_t
+{
+	std::mutex Mutex;
+	std::vector<JointTraceHistogram_t*> Threads;
+	JointTraceHistogram_t Exited; // What the threads that have exited recorded.
+};
+
+inline JointTraceRegistry_t& JointTraceRegistry()
+{
+	// Never destroyed, since threads may still exit after static destructors have run.
+	static JointTraceRegistry_t* Registry = new JointTraceRegistry_t();
+	return *Registry;
+}
+
+struct JointTraceThreadState_t
+{
+	JointTraceHistogram_t* Histogram;
+
+	JointTraceThreadState_t() : Histogram(nullptr)
+	{
+	}
+
+	~JointTraceThreadState_t()
+	{
+		if (Histogram == nullptr)
+		{
+			return;
+		}
+		JointTraceRegistry_t& Registry = JointTraceRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		for (int p=0; p <JOINTPOINTER_TRACE_PHASES; p++)
+		{
+			for (int i=0; i <JOINTPOINTERMATH_TRACE_BUCKETS; i++)
+			{
+				Registry.Exited.Counts[p][i].fetch_add(Histogram->Counts[p][i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+			uint64_t Max = Histogram->Max[p].load(std::memory_order_relaxed);
+			if (Max > Registry.Exited.Max[p].load(std::memory_order_relaxed))
+			{
+				Registry.Exited.Max[p].store(Max, std::memory_order_relaxed);
+			}
+		}
+		for (size_t i=0; i <Registry.Threads.size(); i++)
+		{
+			if (Registry.Threads[i] == Histogram)
+			{
+				Registry.Threads[i] = Registry.Threads.back();
+				Registry.Threads.pop_back();
+				break;
+			}
+		}
+		delete Histogram;
+	}
+};
+
+inline JointTraceHistogram_t& JointTraceThreadHistogram()
+{
+	static thread_local JointTraceThreadState_t State;
+	if (State.Histogram == nullptr)
+	{
+		State.Histogram = new JointTraceHistogram_t();
+		JointTraceRegistry_t& Registry = JointTraceRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		Registry.Threads.push_back(State.Histogram);
+	}
+	return *State.Histogram;
+}
+
+inline void JointTraceRecord(JointTraceHistogram_t& Histogram, int Phase, uint64_t Ticks)
+{
+	std::atomic<uint64_t>& Count = Histogram.Counts[Phase][JointTraceBucket(Ticks)];
+	Count.store(Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if (Ticks > Histogram.Max[Phase].load(std::memory_order_relaxed))
+	{
+		Histogram.Max[Phase].store(Ticks, std::memory_order_relaxed);
+	}
+}
+
+struct JointTraceTimer_t
+{
+	uint64_t Last;
+	uint64_t Ticks[JOINTPOINTER_TRACE_PHASES];
+
+	JointTraceTimer_t() : Last(JointTraceNow())
+	{
+	}
+
+	void Mark(JointTracePhase Phase)
+	{
+		uint64_t Now = JointTraceNow();
+		Ticks[Phase] = Now - Last;
+		Last = Now;
+	}
+
+	void Finish(void* Memory, size_t TotalSize, int Num)
+	{
+		JointTraceHistogram_t& Histogram = JointTraceThreadHistogram();
+		for (int p=0; p <JOINTPOINTER_TRACE_PHASES; p++)
+		{
+			JointTraceRecord(Histogram, p, Ticks[p]);
+		}
+#if JOINTPOINTERMATH_HAS_SDT
+		DTRACE_PROBE6(jointpointer, allocate, Memory, TotalSize, Num, Ticks[JOINTPOINTER_TRACE_LAYOUT], Ticks[JOINTPOINTER_TRACE_ALLOCATE], Ticks[JOINTPOINTER_TRACE_WRITE]);
+#else
+		(void)Memory;
+		(void)TotalSize;
+		(void)Num;
+#endif
+	}
+};
+#endif
+
+// The hooks the allocating functions use: START at the top, PHASE at the end of each phase, FINISH once the
+// pointers are written. JointPointerFree uses FREE. When tracing is off they expand to nothing.
+#if JOINTPOINTERMATH_TRACE
+#define JOINTPOINTERMATH_TRACE_START(Timer) JointTraceTimer_t Timer
+#define JOINTPOINTERMATH_TRACE_PHASE(Timer, Which) Timer.Mark(Which)
+#define JOINTPOINTERMATH_TRACE_FINISH(Timer, Memory, TotalSize, Num) Timer.Finish((Memory), (TotalSize), (int)(Num))
+#if JOINTPOINTERMATH_HAS_SDT
+#define JOINTPOINTERMATH_TRACE_FREE(Memory, TotalSize) DTRACE_PROBE2(jointpointer, free, (Memory), (TotalSize))
+#else
+#define JOINTPOINTERMATH_TRACE_FREE(Memory, TotalSize) ((void)0)
+#endif
+#else
+#define JOINTPOINTERMATH_TRACE_START(Timer) ((void)0)
+#define JOINTPOINTERMATH_TRACE_PHASE(Timer, Which) ((void)0)
+#define JOINTPOINTERMATH_TRACE_FINISH(Timer, Memory, TotalSize, Num) ((void)0)
+#define JOINTPOINTERMATH_TRACE_FREE(Memory, TotalSize) ((void)0)
+#endif
+
+struct JointTraceSummary_t
+{
+	uint64_t Count;
+	uint64_t P50; // Percentiles and Max in ticks of JointTraceNow.
+	uint64_t P90;
+	uint64_t P99;
+	uint64_t P999;
+	uint64_t Max;
+	double TicksPerNs;
+};
+
+// Merges the histograms of every thread, running or exited, for Phase. All zero when tracing is off.
+inline JointTraceSummary_t JointTraceSummarise(JointTracePhase Phase)
+{
+	JointTraceSummary_t Summary;
+	memset(&Summary, 0, sizeof(Summary));
+#if JOINTPOINTERMATH_TRACE
+	std::vector<uint64_t> Counts(JOINTPOINTERMATH_TRACE_BUCKETS, 0);
+	{
+		JointTraceRegistry_t& Registry = JointTraceRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		std::vector<const JointTraceHistogram_t*> All(Registry.Threads.begin(), Registry.Threads.end());
+		All.push_back(&Registry.Exited);
+		for (const JointTraceHistogram_t* Histogram : All)
+		{
+			for (int i=0; i <JOINTPOINTERMATH_TRACE_BUCKETS; i++)
+			{
+				Counts[i] += Histogram->Counts[Phase][i].load(std::memory_order_relaxed);
+			}
+			uint64_t Max = Histogram->Max[Phase].load(std::memory_order_relaxed);
+			Summary.Max = Max > Summary.Max ? Max : Summary.Max;
+		}
+	}
+	for (int i=0; i <JOINTPOINTERMATH_TRACE_BUCKETS; i++)
+	{
+		Summary.Count += Counts[i];
+	}
+	const double Quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	uint64_t* Outs[] = { &Summary.P50, &Summary.P90, &Summary.P99, &Summary.P999 };
+	uint64_t Seen = 0;
+	int q = 0;
+	for (int i=0; i <JOINTPOINTERMATH_TRACE_BUCKETS && q <4; i++)
+	{
+		Seen += Counts[i];
+		while (q <4 && Summary.Count > 0 && (double)Seen >= Quantiles[q] * (double)Summary.Count)
+		{
+			*Outs[q++] = JointTraceBucketStart(i);
+		}
+	}
+	Summary.TicksPerNs = JointTraceTicksPerNanosecond();
+#else
+	(void)Phase;
+#endif
+	return Summary;
+}
+
+inline bool JointTraceDump(FILE* File)
+{
+	JOINTPOINTERMATH_ASSERT(File != nullptr);
+#if JOINTPOINTERMATH_TRACE
+	static const char* const Names[JOINTPOINTER_TRACE_PHASES] = { "layout", "allocate", "write" };
+	for (int p=0; p <JOINTPOINTER_TRACE_PHASES; p++)
+	{
+		JointTraceSummary_t Summary = JointTraceSummarise((JointTracePhase)p);
+		double Ns = 1.0 / Summary.TicksPerNs;
+		fprintf(File, "%-8s count %llu, ns p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n", Names[p], (unsigned long long)Summary.Count,
+			(double)Summary.P50 * Ns, (double)Summary.P90 * Ns, (double)Summary.P99 * Ns, (double)Summary.P999 * Ns, (double)Summary.Max * Ns);
+	}
+	return ferror(File) == 0;
+#else
+	(void)File;
+	return false;
+#endif
+}
+
+inline void JointPointerWrite(void* Memory, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	for (int i=0; i <Num; i++)
+	{
+		*Elems[i].Pointer = ((char*)Memory) + Elems[i].Offset;
+	}
+}
+
+inline void JointPointerClearPadding(void* Memory, int Num, const JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num >= 0);
+	JOINTPOINTERMATH_ASSERT(Num == 0 || Elems != nullptr);
+	if (Memory == nullptr)
+	{
+		return;
+	}
+	for (int i=0; i <Num; i++)
+	{
+		if (JointPointerPaddingOf(Elems[i]) != 0)
+		{
+			memset(((char*)Memory) + Elems[i].Offset + Elems[i].Size, 0, JointPointerPaddedSize(Elems[i]) - Elems[i].Size);
+		}
+	}
+}
+
+inline size_t JointPointerMaxAlignment(int Num, const JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	size_t Alignment = 1;
+	for (int i=0; i <Num; i++)
+	{
+		if (JointPointerAlignmentOf(Elems[i]) > Alignment)
+		{
+			Alignment = JointPointerAlignmentOf(Elems[i]);
+		}
+	}
+	return Alignment;
+}
+
+// Ranks the JointAllocatorDispatch overloads, so an allocator that fits more than one kind uses the highest one.
+template<int N> struct JointRank : JointRank<N - 1>
+{
+};
+
+template<> struct JointRank<0>
+{
+};
+
+// A pointer to a memory resource, such as std::pmr::memory_resource*.
+template<typename AllocT> auto JointAllocatorDispatch(JointRank<5>, AllocT& Alloc, size_t Size, size_t Alignment) -> decltype((void*)Alloc->allocate(Size, Alignment))
+{
+	return Alloc->allocate(Size, Alignment);
+}
+
+// A memory resource passed by reference.
+template<typename AllocT> auto JointAllocatorDispatch(JointRank<5>, AllocT& Alloc, size_t Size, size_t Alignment) -> decltype((void*)Alloc.allocate(Size, Alignment))
+{
+	return Alloc.allocate(Size, Alignment);
+}
+
+// An object with Allocate(Size, Alignment), such as JointArena.
+template<typename AllocT> auto JointAllocatorDispatch(JointRank<4>, AllocT& Alloc, size_t Size, size_t Alignment) -> decltype((void*)Alloc.Allocate(Size, Alignment))
+{
+	return Alloc.Allocate(Size, Alignment);
+}
+
+inline size_t JointAllocatorUnits(size_t Size)
+{
+	return (Size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+}
+
+// A standard Allocator. It's rebound to std::max_align_t, so it can only give out that much alignment.
+template<typename AllocT> auto JointAllocatorDispatch(JointRank<3>, AllocT& Alloc, size_t Size, size_t Alignment) -> decltype((typename AllocT::value_type*)nullptr, Alloc.allocate(Size), (void*)nullptr)
+{
+	typedef typename std::allocator_traits<AllocT>::template rebind_alloc<std::max_align_t> UnitAlloc;
+	JOINTPOINTERMATH_ASSERT(Alignment <= std::alignment_of<std::max_align_t>::value);
+	(void)Alignment;
+	UnitAlloc Units(Alloc);
+	return (void*)std::allocator_traits<UnitAlloc>::allocate(Units, JointAllocatorUnits(Size));
+}
+
+// Anything callable as Alloc(Size, Alignment).
+template<typename AllocT> auto JointAllocatorDispatch(JointRank<2>, AllocT& Alloc, size_t Size, size_t Alignment) -> decltype((void*)Alloc(Size, Alignment))
+{
+	return Alloc(Size, Alignment);
+}
+
+// Anything callable as Alloc(Size), such as malloc. The alignment is up to the allocator.
+template<typename AllocT> auto JointAllocatorDispatch(JointRank<1>, AllocT& Alloc, size_t Size, size_t) -> decltype((void*)Alloc(Size))
+{
+	return Alloc(Size);
+}
+
+template<typename AllocT> void* JointAllocatorAllocate(AllocT&& Alloc, size_t Size, size_t Alignment)
+{
+	return JointAllocatorDispatch(JointRank<5>(), Alloc, Size, Alignment);
+}
+
+template<typename AllocT> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	JOINTPOINTERMATH_TRACE_START(Trace);
+	size_t TotalSize = JointPointerTotalSize(Num, Elems);
+	size_t Alignment = JointPointerMaxAlignment(Num, Elems);
+	if (OutSize != nullptr)
+	{
+		*OutSize = TotalSize;
+	}
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_LAYOUT);
+	void* Memory = JointAllocatorAllocate(Alloc, TotalSize, Alignment);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_ALLOCATE);
+	JointPointerWrite(Memory, Num, Elems);
+	JointPointerClearPadding(Memory, Num, Elems);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_WRITE);
+	JOINTPOINTERMATH_TRACE_FINISH(Trace, Memory, TotalSize, Num);
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, Num, JointStatsPayload(Num, Elems));
+	return Memory;
+}
+
+template<typename AllocT, int Num> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, JointPointer_t (&Arr)[Num])
+{
+	return JointPointerAllocate(OutSize, Alloc, Num, Arr);
+}
+
+template<typename AllocT> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, std::initializer_list<JointPointer_t> ini)
+{
+	JOINTPOINTERMATH_ASSERT(ini.size() > 0);
+	JOINTPOINTERMATH_TRACE_START(Trace);
+
+	// Determine total size.
+	void* Ptr = 0;
+	size_t Alignment = 1;
+	for (const JointPointer_t& JP : ini)
+	{
+		size_t Ignore = std::numeric_limits<std::size_t>::max();
+		Ptr = std::align(JointPointerAlignmentOf(JP), JointPointerExtentOf(JP), Ptr, Ignore);
+		Ptr = ((char*)Ptr) + JointPointerExtentOf(JP);
+		Alignment = JointPointerAlignmentOf(JP) > Alignment ? JointPointerAlignmentOf(JP) : Alignment;
 	}
 	size_t TotalSize = (size_t)Ptr;
 	if (OutSize != nullptr)
 	{
 		*OutSize = TotalSize;
 	}
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_LAYOUT);
 
-	void* Memory = Alloc(TotalSize, ini.begin()->Alignment);
+	void* Memory = JointAllocatorAllocate(Alloc, TotalSize, Alignment);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_ALLOCATE);
 
 	// Write pointers.
 	Ptr = 0;
 	for (const JointPointer_t& JP : ini)
 	{
 		size_t Ignore = std::numeric_limits<std::size_t>::max();
-		Ptr = std::align(JP.Alignment, JP.Size, Ptr, Ignore);
+		Ptr = std::align(JointPointerAlignmentOf(JP), JointPointerExtentOf(JP), Ptr, Ignore);
 		*JP.Pointer = (char*)Memory + (size_t)Ptr;
-		Ptr = ((char*)Ptr) + JP.Size;
+		Ptr = ((char*)Ptr) + JointPointerExtentOf(JP);
+		if (JointPointerPaddingOf(JP) != 0 && Memory != nullptr)
+		{
+			memset(((char*)*JP.Pointer) + JP.Size, 0, JointPointerPaddedSize(JP) - JP.Size);
+		}
 	}
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_WRITE);
+	JOINTPOINTERMATH_TRACE_FINISH(Trace, Memory, TotalSize, ini.size());
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, ini.size(), JointStatsPayload(ini));
 	return Memory;
 }
 
+// A pointer to a memory resource, such as std::pmr::memory_resource*.
+template<typename FreeT> auto JointDeallocatorDispatch(JointRank<5>, FreeT& Free, void* Memory, size_t Size, size_t Alignment) -> decltype(Free->deallocate(Memory, Size, Alignment), std::true_type())
+{
+	Free->deallocate(Memory, Size, Alignment);
+	return std::true_type();
+}
+
+// A memory resource passed by reference.
+template<typename FreeT> auto JointDeallocatorDispatch(JointRank<5>, FreeT& Free, void* Memory, size_t Size, size_t Alignment) -> decltype(Free.deallocate(Memory, Size, Alignment), std::true_type())
+{
+	Free.deallocate(Memory, Size, Alignment);
+	return std::true_type();
+}
+
+// A standard Allocator, given back the std::max_align_t units JointAllocatorAllocate took from it.
+template<typename FreeT> auto JointDeallocatorDispatch(JointRank<3>, FreeT& Free, void* Memory, size_t Size, size_t) -> decltype((typename FreeT::value_type*)nullptr, Free.deallocate(nullptr, Size), std::true_type())
+{
+	typedef typename std::allocator_traits<FreeT>::template rebind_alloc<std::max_align_t> UnitAlloc;
+	UnitAlloc Units(Free);
+	std::allocator_traits<UnitAlloc>::deallocate(Units, (std::max_align_t*)Memory, JointAllocatorUnits(Size));
+	return std::true_type();
+}
+
+// Anything callable as Free(Memory, Size, Alignment), such as JointNewFree or a wrapper around sdallocx.
+template<typename FreeT> auto JointDeallocatorDispatch(JointRank<2>, FreeT& Free, void* Memory, size_t Size, size_t Alignment) -> decltype(Free(Memory, Size, Alignment), std::true_type())
+{
+	Free(Memory, Size, Alignment);
+	return std::true_type();
+}
+
+// Anything callable as Free(Memory, Size), such as C23's free_sized.
+template<typename FreeT> auto JointDeallocatorDispatch(JointRank<1>, FreeT& Free, void* Memory, size_t Size, size_t) -> decltype(Free(Memory, Size), std::true_type())
+{
+	Free(Memory, Size);
+	return std::true_type();
+}
+
+// Anything callable as Free(Memory), such as free.
+template<typename FreeT> auto JointDeallocatorDispatch(JointRank<0>, FreeT& Free, void* Memory, size_t, size_t) -> decltype(Free(Memory), std::false_type())
+{
+	Free(Memory);
+	return std::false_type();
+}
+
+// Whether JointDeallocatorDispatch passes the size on to FreeT, so it has to be kept until the memory is freed.
+// Each overload above returns std::true_type when it uses the size, so this asks the overload the dispatch picks.
+template<typename FreeT> struct JointDeallocatorIsSized : decltype(JointDeallocatorDispatch(JointRank<5>(), std::declval<FreeT&>(), (void*)nullptr, (size_t)0, (size_t)0))
+{
+};
+
+template<typename FreeT> void JointDeallocatorFree(FreeT&& Free, void* Memory, size_t Size, size_t Alignment)
+{
+	JointDeallocatorDispatch(JointRank<5>(), Free, Memory, Size, Alignment);
+}
+
+template<typename FreeT> void JointPointerFree(FreeT&& Free, void* Memory, size_t Size, size_t Alignment)
+{
+	if (Memory == nullptr)
+	{
+		return;
+	}
+	JOINTPOINTERMATH_STATS_FREE(Memory, Size);
+	JOINTPOINTERMATH_TRACE_FREE(Memory, Size);
+	JointDeallocatorFree(Free, Memory, Size, Alignment);
+}
+
+// Elems as the allocating call laid them out: the size comes from their offsets.
+template<typename FreeT> void JointPointerFree(FreeT&& Free, void* Memory, int Num, const JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	size_t Size = 0;
+	for (int i=0; i <Num; i++)
+	{
+		size_t End = Elems[i].Offset + JointPointerExtentOf(Elems[i]);
+		Size = End > Size ? End : Size;
+	}
+	JointPointerFree(Free, Memory, Size, JointPointerMaxAlignment(Num, Elems));
+}
+
+template<typename FreeT, int Num> void JointPointerFree(FreeT&& Free, void* Memory, const JointPointer_t (&Arr)[Num])
+{
+	JointPointerFree(Free, Memory, Num, Arr);
+}
+
+// Written just before the first section by JointPointerAllocateWithHeader.
+struct JointBlockHeader_t
+{
+	uint64_t TotalSize; // Of the layout, without the header.
+	uint32_t Alignment;
+	uint32_t LayoutId;
+};
+
+// The header is padded to the block's alignment, so the first section stays aligned.
+inline size_t JointBlockHeaderSize(size_t Alignment)
+{
+	return JointAlignUp(sizeof(JointBlockHeader_t), Alignment);
+}
+
+template<typename AllocT> void* JointPointerAllocateWithHeader(size_t* OutSize, AllocT&& Alloc, uint32_t LayoutId, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	size_t TotalSize = JointPointerTotalSize(Num, Elems);
+	size_t Alignment = JointPointerMaxAlignment(Num, Elems);
+	Alignment = Alignment > std::alignment_of<JointBlockHeader_t>::value ? Alignment : std::alignment_of<JointBlockHeader_t>::value;
+	JOINTPOINTERMATH_ASSERT(Alignment <= std::numeric_limits<uint32_t>::max());
+	size_t HeaderSize = JointBlockHeaderSize(Alignment);
+	if (OutSize != nullptr)
+	{
+		*OutSize = TotalSize;
+	}
+	if (TotalSize > std::numeric_limits<size_t>::max() - HeaderSize)
+	{
+		return nullptr;
+	}
+	char* Block = (char*)JointAllocatorAllocate(Alloc, HeaderSize + TotalSize, Alignment);
+	if (Block == nullptr)
+	{
+		return nullptr;
+	}
+	char* Memory = Block + HeaderSize;
+	JointBlockHeader_t* Header = ((JointBlockHeader_t*)Memory) - 1;
+	Header->TotalSize = TotalSize;
+	Header->Alignment = (uint32_t)Alignment;
+	Header->LayoutId = LayoutId;
+	JointPointerWrite(Memory, Num, Elems);
+	JointPointerClearPadding(Memory, Num, Elems);
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, HeaderSize + TotalSize, Num, JointStatsPayload(Num, Elems));
+	return Memory;
+}
+
+template<typename AllocT, int Num> void* JointPointerAllocateWithHeader(size_t* OutSize, AllocT&& Alloc, uint32_t LayoutId, JointPointer_t (&Arr)[Num])
+{
+	return JointPointerAllocateWithHeader(OutSize, Alloc, LayoutId, Num, Arr);
+}
+
+inline const JointBlockHeader_t* JointPointerHeader(const void* Memory)
+{
+	JOINTPOINTERMATH_ASSERT(Memory != nullptr);
+	return ((const JointBlockHeader_t*)Memory) - 1;
+}
+
+template<typename FreeT> void JointPointerFreeWithHeader(FreeT&& Free, void* Memory)
+{
+	if (Memory == nullptr)
+	{
+		return;
+	}
+	const JointBlockHeader_t* Header = JointPointerHeader(Memory);
+	size_t HeaderSize = JointBlockHeaderSize(Header->Alignment);
+	JointPointerFree(Free, ((char*)Memory) - HeaderSize, HeaderSize + (size_t)Header->TotalSize, Header->Alignment);
+}
+
+template<typename T, size_t Count, size_t Align = std::alignment_of<T>::value> struct JointSection
+{
+	static_assert(Align > 0 && (Align & (Align - 1)) == 0, "JointSection alignment must be a power of two");
+
+	typedef T Type;
+	static const size_t Size = sizeof(T) * Count;
+	static const size_t Alignment = Align;
+};
+
+// Places each section after the previous one, starting at Begin.
+template<size_t Begin, typename... Sections> struct JointLayoutImpl;
+
+template<size_t Begin> struct JointLayoutImpl<Begin>
+{
+	static const size_t End = Begin;
+	static const size_t MaxAlignment = 1;
+
+	static void Write(char*) {}
+};
+
+template<size_t Begin, typename S, typename... Rest> struct JointLayoutImpl<Begin, S, Rest...>
+{
+	static const size_t Offset = JointAlignUp(Begin, S::Alignment);
+
+	typedef JointLayoutImpl<Offset + S::Size, Rest...> Next;
+	static const size_t End = Next::End;
+	static const size_t MaxAlignment = S::Alignment > Next::MaxAlignment ? S::Alignment : Next::MaxAlignment;
+
+	static void Write(char* Memory, typename S::Type** Ptr, typename Rest::Type**... Ptrs)
+	{
+		*Ptr = (typename S::Type*)(Memory + Offset);
+		Next::Write(Memory, Ptrs...);
+	}
+};
+
+template<size_t I, typename Impl> struct JointLayoutOffset
+{
+	static const size_t Value = JointLayoutOffset<I - 1, typename Impl::Next>::Value;
+};
+
+template<typename Impl> struct JointLayoutOffset<0, Impl>
+{
+	static const size_t Value = Impl::Offset;
+};
+
+template<typename... Sections> struct JointLayout
+{
+	static_assert(sizeof...(Sections) > 0, "JointLayout needs at least one section");
+
+	typedef JointLayoutImpl<0, Sections...> Impl;
+
+	static const size_t Count = sizeof...(Sections);
+	static const size_t TotalSize = Impl::End;
+	static const size_t Alignment = Impl::MaxAlignment;
+
+	template<size_t I> static constexpr size_t Offset()
+	{
+		static_assert(I < sizeof...(Sections), "JointLayout section index out of range");
+		return JointLayoutOffset<I, Impl>::Value;
+	}
+
+	static void Write(void* Memory, typename Sections::Type**... Ptrs)
+	{
+		Impl::Write((char*)Memory, Ptrs...);
+	}
+
+	template<typename AllocT> static void* Allocate(size_t* OutSize, AllocT&& Alloc, typename Sections::Type**... Ptrs)
+	{
+		if (OutSize != nullptr)
+		{
+			*OutSize = TotalSize;
+		}
+		void* Memory = JointAllocatorAllocate(Alloc, TotalSize, Alignment);
+		Impl::Write((char*)Memory, Ptrs...);
+		JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, Count, JointStatsSum({(size_t)Sections::Size...}));
+		return Memory;
+	}
+};
+
+template<typename... Sections> const size_t JointLayout<Sections...>::Count;
+template<typename... Sections> const size_t JointLayout<Sections...>::TotalSize;
+template<typename... Sections> const size_t JointLayout<Sections...>::Alignment;
+
+template<typename T, size_t Align> struct JointStaticPointer_t
+{
+	static_assert(Align > 0 && (Align & (Align - 1)) == 0, "JointStaticPointer_t alignment must be a power of two");
+
+	T** Pointer;
+	size_t Size;
+
+	JointStaticPointer_t(T** P, size_t Sz)
+	{
+		Pointer = P;
+		Size = Sz;
+	}
+};
+
+template<typename T> JointStaticPointer_t<T, std::alignment_of<T>::value> JointStaticPointer(T** Ptr, size_t Sz)
+{
+	JOINTPOINTERMATH_ASSERT(Ptr != nullptr);
+	return JointStaticPointer_t<T, std::alignment_of<T>::value>(Ptr, Sz);
+}
+
+template<size_t Align, typename T> JointStaticPointer_t<T, Align> JointStaticPointer(T** Ptr, size_t Sz)
+{
+	JOINTPOINTERMATH_ASSERT(Ptr != nullptr);
+	return JointStaticPointer_t<T, Align>(Ptr, Sz);
+}
+
+template<size_t... Aligns> struct JointMaxAlignment;
+
+template<> struct JointMaxAlignment<>
+{
+	static const size_t Value = 1;
+};
+
+template<size_t Align, size_t... Rest> struct JointMaxAlignment<Align, Rest...>
+{
+	static const size_t Value = Align > JointMaxAlignment<Rest...>::Value ? Align : JointMaxAlignment<Rest...>::Value;
+};
+
+// Each call handles one section; the recursion is resolved at compile time, leaving one mask-and-add per section.
+inline size_t JointStaticOffsets(size_t Offset, size_t*)
+{
+	return Offset;
+}
+
+template<typename T, size_t Align, typename... Rest> size_t JointStaticOffsets(size_t Offset, size_t* Offsets, const JointStaticPointer_t<T, Align>& Elem, const Rest&... Elems)
+{
+	Offset = (Offset + (Align - 1)) & ~(Align - 1);
+	*Offsets = Offset;
+	return JointStaticOffsets(Offset + Elem.Size, Offsets + 1, Elems...);
+}
+
+inline void JointStaticWrite(char*, const size_t*)
+{
+}
+
+template<typename T, size_t Align, typename... Rest> void JointStaticWrite(char* Memory, const size_t* Offsets, const JointStaticPointer_t<T, Align>& Elem, const Rest&... Elems)
+{
+	*Elem.Pointer = (T*)(Memory + *Offsets);
+	JointStaticWrite(Memory, Offsets + 1, Elems...);
+}
+
+template<typename AllocT, typename... Ts, size_t... Aligns> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, JointStaticPointer_t<Ts, Aligns>... Elems)
+{
+	static_assert(sizeof...(Ts) > 0, "JointPointerAllocate needs at least one section");
+	size_t Offsets[sizeof...(Ts)];
+	size_t TotalSize = JointStaticOffsets(0, Offsets, Elems...);
+	if (OutSize != nullptr)
+	{
+		*OutSize = TotalSize;
+	}
+	void* Memory = JointAllocatorAllocate(Alloc, TotalSize, JointMaxAlignment<Aligns...>::Value);
+	JointStaticWrite((char*)Memory, Offsets, Elems...);
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, sizeof...(Ts), JointStatsSum({Elems.Size...}));
+	return Memory;
+}
+
+inline size_t JointPointerTotalSizePacked(int Num, JointPointer_t* Elems, size_t* OutSaved)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	size_t DeclaredSize = JointPointerTotalSize(Num, Elems);
+
+	// Alignments are powers of two, so walking the bits from high to low and taking the unpinned sections
+	// with that alignment in declared order gives a stable descending sort, without any scratch memory.
+	int Bit = std::numeric_limits<size_t>::digits - 1;
+	int Next = -1;
+	size_t Offset = 0;
+	for (int i=0; i <Num; i++)
+	{
+		JOINTPOINTERMATH_ASSERT(Elems[i].Alignment > 0 && (Elems[i].Alignment & (Elems[i].Alignment - 1)) == 0);
+		JointPointer_t* Elem = &Elems[i];
+		if ((Elem->Flags & JOINTPOINTER_PINNED) == 0)
+		{
+			do
+			{
+				if (++Next == Num)
+				{
+					Next = 0;
+					Bit--;
+				}
+			} while ((Elems[Next].Flags & JOINTPOINTER_PINNED) != 0 || JointPointerAlignmentOf(Elems[Next]) != ((size_t)1 << Bit));
+			Elem = &Elems[Next];
+		}
+		Offset = JointAlignUp(Offset, JointPointerAlignmentOf(*Elem));
+		Elem->Offset = Offset;
+		Offset += JointPointerExtentOf(*Elem);
+	}
+
+	if (Offset >= DeclaredSize)
+	{
+		Offset = JointPointerTotalSize(Num, Elems);
+	}
+	if (OutSaved != nullptr)
+	{
+		*OutSaved = DeclaredSize - Offset;
+	}
+	return Offset;
+}
+
+template<int Num> size_t JointPointerTotalSizePacked(JointPointer_t (&Arr)[Num], size_t* OutSaved)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	return JointPointerTotalSizePacked(Num, Arr, OutSaved);
+}
+
+template<typename AllocT> void* JointPointerAllocatePacked(size_t* OutSize, size_t* OutSaved, AllocT&& Alloc, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	JOINTPOINTERMATH_TRACE_START(Trace);
+	size_t TotalSize = JointPointerTotalSizePacked(Num, Elems, OutSaved);
+	size_t Alignment = JointPointerMaxAlignment(Num, Elems);
+	if (OutSize != nullptr)
+	{
+		*OutSize = TotalSize;
+	}
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_LAYOUT);
+	void* Memory = JointAllocatorAllocate(Alloc, TotalSize, Alignment);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_ALLOCATE);
+	JointPointerWrite(Memory, Num, Elems);
+	JointPointerClearPadding(Memory, Num, Elems);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_WRITE);
+	JOINTPOINTERMATH_TRACE_FINISH(Trace, Memory, TotalSize, Num);
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, Num, JointStatsPayload(Num, Elems));
+	return Memory;
+}
+
+template<typename AllocT, int Num> void* JointPointerAllocatePacked(size_t* OutSize, size_t* OutSaved, AllocT&& Alloc, JointPointer_t (&Arr)[Num])
+{
+	return JointPointerAllocatePacked(OutSize, OutSaved, Alloc, Num, Arr);
+}
+
+// Moves the sections that shifted towards the start of the buffer, lowest first, merging runs that shifted by the same distance.
+inline void JointPointerMoveDown(char* Memory, int Num, const JointPointer_t* OldElems, const JointPointer_t* NewElems)
+{
+	for (int i=0; i <Num; i++)
+	{
+		if (NewElems[i].Offset >= OldElems[i].Offset)
+		{
+			continue;
+		}
+		size_t Delta = OldElems[i].Offset - NewElems[i].Offset;
+		int Last = i;
+		while (Last + 1 < Num && NewElems[Last + 1].Offset < OldElems[Last + 1].Offset && OldElems[Last + 1].Offset - NewElems[Last + 1].Offset == Delta)
+		{
+			Last++;
+		}
+		size_t LastSize = OldElems[Last].Size < NewElems[Last].Size ? OldElems[Last].Size : NewElems[Last].Size;
+		memmove(Memory + NewElems[i].Offset, Memory + OldElems[i].Offset, OldElems[Last].Offset + LastSize - OldElems[i].Offset);
+		i = Last;
+	}
+}
+
+// Moves the sections that shifted towards the end of the buffer, highest first, merging runs that shifted by the same distance.
+inline void JointPointerMoveUp(char* Memory, int Num, const JointPointer_t* OldElems, const JointPointer_t* NewElems)
+{
+	for (int i=Num - 1; i >= 0; i--)
+	{
+		if (NewElems[i].Offset <= OldElems[i].Offset)
+		{
+			continue;
+		}
+		size_t Delta = NewElems[i].Offset - OldElems[i].Offset;
+		int First = i;
+		while (First > 0 && NewElems[First - 1].Offset > OldElems[First - 1].Offset && NewElems[First - 1].Offset - OldElems[First - 1].Offset == Delta)
+		{
+			First--;
+		}
+		size_t LastSize = OldElems[i].Size < NewElems[i].Size ? OldElems[i].Size : NewElems[i].Size;
+		memmove(Memory + NewElems[First].Offset, Memory + OldElems[First].Offset, OldElems[i].Offset + LastSize - OldElems[First].Offset);
+		i = First;
+	}
+}
+
+template<typename ReallocT> void* JointPointerReallocate(void* Memory, size_t* OutSize, ReallocT&& Realloc, int Num, const JointPointer_t* OldElems, JointPointer_t* NewElems)
+{
+	JOINTPOINTERMATH_ASSERT(Memory != nullptr);
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(OldElems != nullptr);
+	JOINTPOINTERMATH_ASSERT(NewElems != nullptr);
+	size_t OldSize = OldElems[Num - 1].Offset + JointPointerExtentOf(OldElems[Num - 1]);
+	size_t NewSize = JointPointerTotalSize(Num, NewElems);
+
+	// Grow before moving and shrink after, so every move happens inside a buffer that holds both layouts.
+	if (NewSize > OldSize)
+	{
+		void* Grown = Realloc(Memory, NewSize);
+		if (Grown == nullptr)
+		{
+			return nullptr;
+		}
+		Memory = Grown;
+		JointPointerMoveDown((char*)Memory, Num, OldElems, NewElems);
+		JointPointerMoveUp((char*)Memory, Num, OldElems, NewElems);
+	}
+	else
+	{
+		JointPointerMoveDown((char*)Memory, Num, OldElems, NewElems);
+		JointPointerMoveUp((char*)Memory, Num, OldElems, NewElems);
+		if (NewSize > 0 && NewSize < OldSize)
+		{
+			void* Shrunk = Realloc(Memory, NewSize);
+			if (Shrunk != nullptr)
+			{
+				Memory = Shrunk;
+			}
+		}
+	}
+
+	if (OutSize != nullptr)
+	{
+		*OutSize = NewSize;
+	}
+	JointPointerWrite(Memory, Num, NewElems);
+	JointPointerClearPadding(Memory, Num, NewElems);
+	JOINTPOINTERMATH_STATS_FREE(Memory, OldSize);
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, NewSize, Num, JointStatsPayload(Num, NewElems));
+	return Memory;
+}
+
+template<typename ReallocT, int Num> void* JointPointerReallocate(void* Memory, size_t* OutSize, ReallocT&& Realloc, const JointPointer_t (&OldArr)[Num], JointPointer_t (&NewArr)[Num])
+{
+	return JointPointerReallocate(Memory, OutSize, Realloc, Num, OldArr, NewArr);
+}
+
+struct JointArenaChunk_t
+{
+	JointArenaChunk_t* Next;
+	char* End;
+};
+
+struct JointArenaMark_t
+{
+	JointArenaChunk_t* Chunk;
+	char* Cursor;
+};
+
+struct JointArena
+{
+	JointArenaChunk_t* First;
+	JointArenaChunk_t* Current;
+	char* Cursor;
+	size_t ChunkSize;
+	void* (*ChunkAlloc)(size_t Size);
+	void (*ChunkFree)(void* Memory);
+
+	explicit JointArena(size_t ChunkSz = JOINTPOINTERMATH_ARENA_CHUNK_SIZE, void* (*Alloc)(size_t Size) = malloc, void (*Free)(void* Memory) = free)
+	{
+		JOINTPOINTERMATH_ASSERT(ChunkSz > 0);
+		JOINTPOINTERMATH_ASSERT(Alloc != nullptr && Free != nullptr);
+		First = nullptr;
+		Current = nullptr;
+		Cursor = nullptr;
+		ChunkSize = ChunkSz;
+		ChunkAlloc = Alloc;
+		ChunkFree = Free;
+	}
+
+	~JointArena()
+	{
+		Release();
+	}
+
+	JointArena(const JointArena&) = delete;
+	JointArena& operator=(const JointArena&) = delete;
+
+	void* Allocate(size_t Size, size_t Alignment)
+	{
+		JOINTPOINTERMATH_ASSERT(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+		if (Current != nullptr)
+		{
+			char* Ptr = (char*)JointAlignUp((size_t)Cursor, Alignment);
+			if (Ptr <= Current->End && Size <= (size_t)(Current->End - Ptr))
+			{
+				Cursor = Ptr + Size;
+				return Ptr;
+			}
+		}
+		return AllocateSlow(Size, Alignment);
+	}
+
+	JointArenaMark_t Mark() const
+	{
+		JointArenaMark_t M;
+		M.Chunk = Current;
+		M.Cursor = Cursor;
+		return M;
+	}
+
+	void Rewind(JointArenaMark_t M)
+	{
+		Current = M.Chunk;
+		Cursor = M.Cursor;
+	}
+
+	void Reset()
+	{
+		Current = nullptr;
+		Cursor = nullptr;
+	}
+
+	void Release()
+	{
+		while (First != nullptr)
+		{
+			JointArenaChunk_t* Next = First->Next;
+			ChunkFree(First);
+			First = Next;
+		}
+		Reset();
+	}
+
+private:
+	static size_t HeaderSize()
+	{
+		return JointAlignUp(sizeof(JointArenaChunk_t), std::alignment_of<max_align_t>::value);
+	}
+
+	static char* ChunkBegin(JointArenaChunk_t* Chunk)
+	{
+		return (char*)Chunk + HeaderSize();
+	}
+
+	void* AllocateSlow(size_t Size, size_t Alignment)
+	{
+		if (Size > std::numeric_limits<size_t>::max() - Alignment)
+		{
+			return nullptr;
+		}
+		size_t Needed = Size + Alignment - 1;
+
+		// Reuse the next chunk if it's big enough, otherwise put a new chunk in front of it.
+		JointArenaChunk_t* Next = Current != nullptr ? Current->Next : First;
+		if (Next == nullptr || (size_t)(Next->End - ChunkBegin(Next)) < Needed)
+		{
+			size_t Capacity = Needed > ChunkSize ? Needed : ChunkSize;
+			if (Capacity > std::numeric_limits<size_t>::max() - HeaderSize())
+			{
+				return nullptr;
+			}
+			JointArenaChunk_t* Chunk = (JointArenaChunk_t*)ChunkAlloc(HeaderSize() + Capacity);
+			if (Chunk == nullptr)
+			{
+				return nullptr;
+			}
+			Chunk->Next = Next;
+			Chunk->End = ChunkBegin(Chunk) + Capacity;
+			if (Current != nullptr)
+			{
+				Current->Next = Chunk;
+			}
+			else
+			{
+				First = Chunk;
+			}
+			Next = Chunk;
+		}
+
+		Current = Next;
+		char* Ptr = (char*)JointAlignUp((size_t)ChunkBegin(Current), Alignment);
+		Cursor = Ptr + Size;
+		return Ptr;
+	}
+};
+
+inline void* JointAlignedMalloc(size_t Size, size_t Alignment)
+{
+	JOINTPOINTERMATH_ASSERT(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+#if defined(_WIN32)
+	return _aligned_malloc(Size, Alignment);
+#else
+	if (Alignment < sizeof(void*))
+	{
+		Alignment = sizeof(void*);
+	}
+	void* Memory = nullptr;
+	if (posix_memalign(&Memory, Alignment, Size) != 0)
+	{
+		return nullptr;
+	}
+	return Memory;
+#endif
+}
+
+inline void JointAlignedFree(void* Memory)
+{
+#if defined(_WIN32)
+	_aligned_free(Memory);
+#else
+	free(Memory);
+#endif
+}
+
+// A matching pair for the sized deallocation path: aligned operator new, and the sized, aligned
+// operator delete, which lets the allocator skip looking up the size class. Before C++17 they fall
+// back to JointAlignedMalloc and JointAlignedFree. JointNewAlloc returns null when out of memory.
+inline void* JointNewAlloc(size_t Size, size_t Alignment)
+{
+#if defined(__cpp_aligned_new)
+	return ::operator new(Size, std::align_val_t(Alignment), std::nothrow);
+#else
+	return JointAlignedMalloc(Size, Alignment);
+#endif
+}
+
+inline void JointNewFree(void* Memory, size_t Size, size_t Alignment)
+{
+#if defined(__cpp_aligned_new) && defined(__cpp_sized_deallocation)
+	::operator delete(Memory, Size, std::align_val_t(Alignment));
+#elif defined(__cpp_aligned_new)
+	(void)Size;
+	::operator delete(Memory, std::align_val_t(Alignment));
+#else
+	(void)Size;
+	(void)Alignment;
+	JointAlignedFree(Memory);
+#endif
+}
+
+struct JointPoolBucket_t
+{
+	JointPoolBucket_t* Next;
+	uint64_t Hash;
+	std::vector<size_t> Signature;
+	size_t TotalSize;
+	size_t Alignment;
+	size_t HeaderSize;
+	std::vector<void*> Blocks;
+
+	bool Matches(uint64_t H, int Num, const JointPointer_t* Elems) const
+	{
+		if (H != Hash || Signature.size() != (size_t)Num * 3)
+		{
+			return false;
+		}
+		for (int i=0; i <Num; i++)
+		{
+			if (Signature[i * 3] != Elems[i].Size || Signature[i * 3 + 1] != Elems[i].Alignment || Signature[i * 3 + 2] != Elems[i].Flags)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+struct JointPoolCache_t
+{
+	struct Slot_t
+	{
+		JointPoolBucket_t* Bucket;
+		int Count;
+		void* Blocks[JOINTPOINTERMATH_POOL_MAGAZINE_SIZE];
+	};
+
+	Slot_t Slots[JOINTPOINTERMATH_POOL_CACHE_SLOTS];
+};
+
+struct JointPool;
+
+// Pools that are still alive, so that exiting threads know whether they can hand their caches back.
+struct JointPoolRegistry_t
+{
+	std::mutex Mutex;
+	std::vector<JointPool*> Pools;
+	uint64_t NextId;
+};
+
+inline JointPoolRegistry_t& JointPoolRegistry()
+{
+	// Never destroyed, since threads may still exit after static destructors have run.
+	static JointPoolRegistry_t* Registry = new JointPoolRegistry_t();
+	return *Registry;
+}
+
+struct JointPoolThreadState_t
+{
+	struct Entry_t
+	{
+		uint64_t PoolId;
+		JointPoolCache_t* Cache;
+	};
+
+	std::vector<Entry_t> Entries;
+
+	~JointPoolThreadState_t();
+};
+
+inline JointPoolThreadState_t& JointPoolThreadState()
+{
+	static thread_local JointPoolThreadState_t State;
+	return State;
+}
+
+struct JointPool
+{
+	void* (*BlockAlloc)(size_t Size, size_t Alignment);
+	void (*BlockFree)(void* Memory);
+	uint64_t Id;
+	std::mutex Mutex;
+	std::unordered_map<uint64_t, JointPoolBucket_t*> Buckets;
+	std::vector<JointPoolCache_t*> Caches;
+	std::vector<JointPoolCache_t*> SpareCaches;
+
+	explicit JointPool(void* (*Alloc)(size_t Size, size_t Alignment) = JointAlignedMalloc, void (*FreeFn)(void* Memory) = JointAlignedFree)
+	{
+		JOINTPOINTERMATH_ASSERT(Alloc != nullptr && FreeFn != nullptr);
+		BlockAlloc = Alloc;
+		BlockFree = FreeFn;
+		JointPoolRegistry_t& Registry = JointPoolRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		Id = ++Registry.NextId;
+		Registry.Pools.push_back(this);
+	}
+
+	~JointPool()
+	{
+		{
+			JointPoolRegistry_t& Registry = JointPoolRegistry();
+			std::lock_guard<std::mutex> Lock(Registry.Mutex);
+			for (size_t i=0; i <Registry.Pools.size(); i++)
+			{
+				if (Registry.Pools[i] == this)
+				{
+					Registry.Pools[i] = Registry.Pools.back();
+					Registry.Pools.pop_back();
+					break;
+				}
+			}
+		}
+		for (JointPoolCache_t* Cache : Caches)
+		{
+			for (JointPoolCache_t::Slot_t& Slot : Cache->Slots)
+			{
+				for (int i=0; i <Slot.Count; i++)
+				{
+					BlockFree((char*)Slot.Blocks[i] - Slot.Bucket->HeaderSize);
+				}
+			}
+			delete Cache;
+		}
+		for (auto& It : Buckets)
+		{
+			JointPoolBucket_t* Bucket = It.second;
+			while (Bucket != nullptr)
+			{
+				JointPoolBucket_t* Next = Bucket->Next;
+				for (void* Block : Bucket->Blocks)
+				{
+					BlockFree((char*)Block - Bucket->HeaderSize);
+				}
+				delete Bucket;
+				Bucket = Next;
+			}
+		}
+	}
+
+	JointPool(const JointPool&) = delete;
+	JointPool& operator=(const JointPool&) = delete;
+
+	void* Allocate(size_t* OutSize, int Num, JointPointer_t* Elems)
+	{
+		JOINTPOINTERMATH_ASSERT(Num > 0);
+		JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+		size_t TotalSize = JointPointerTotalSize(Num, Elems);
+		if (OutSize != nullptr)
+		{
+			*OutSize = TotalSize;
+		}
+
+		uint64_t Hash = HashLayout(Num, Elems);
+		JointPoolCache_t::Slot_t& Slot = ThreadCache()->Slots[Hash % JOINTPOINTERMATH_POOL_CACHE_SLOTS];
+		void* Memory = nullptr;
+		if (Slot.Count > 0 && Slot.Bucket->Matches(Hash, Num, Elems))
+		{
+			Memory = Slot.Blocks[--Slot.Count];
+		}
+		else
+		{
+			JointPoolBucket_t* Bucket;
+			{
+				std::lock_guard<std::mutex> Lock(Mutex);
+				Bucket = FindBucket(Hash, Num, Elems, TotalSize);
+				if (Slot.Bucket != Bucket)
+				{
+					FlushSlot(Slot);
+					Slot.Bucket = Bucket;
+				}
+				while (Slot.Count < JOINTPOINTERMATH_POOL_MAGAZINE_SIZE / 2 && !Bucket->Blocks.empty())
+				{
+					Slot.Blocks[Slot.Count++] = Bucket->Blocks.back();
+					Bucket->Blocks.pop_back();
+				}
+			}
+			if (Slot.Count > 0)
+			{
+				Memory = Slot.Blocks[--Slot.Count];
+			}
+			else
+			{
+				char* Block = (char*)BlockAlloc(Bucket->HeaderSize + TotalSize, Bucket->Alignment);
+				if (Block == nullptr)
+				{
+					return nullptr;
+				}
+				Memory = Block + Bucket->HeaderSize;
+				((JointPoolBucket_t**)Memory)[-1] = Bucket;
+			}
+		}
+		JointPointerWrite(Memory, Num, Elems);
+		JointPointerClearPadding(Memory, Num, Elems);
+		JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, Num, JointStatsPayload(Num, Elems));
+		return Memory;
+	}
+
+	template<int Num> void* Allocate(size_t* OutSize, JointPointer_t (&Arr)[Num])
+	{
+		return Allocate(OutSize, Num, Arr);
+	}
+
+	void Free(void* Memory)
+	{
+		if (Memory == nullptr)
+		{
+			return;
+		}
+		JointPoolBucket_t* Bucket = ((JointPoolBucket_t**)Memory)[-1];
+		JOINTPOINTERMATH_STATS_FREE(Memory, Bucket->TotalSize);
+		JointPoolCache_t::Slot_t& Slot = ThreadCache()->Slots[Bucket->Hash % JOINTPOINTERMATH_POOL_CACHE_SLOTS];
+		if (Slot.Bucket != Bucket || Slot.Count == JOINTPOINTERMATH_POOL_MAGAZINE_SIZE)
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			if (Slot.Bucket != Bucket)
+			{
+				FlushSlot(Slot);
+				Slot.Bucket = Bucket;
+			}
+			else
+			{
+				// Keep the hot half of the magazine, move the rest to the depot.
+				for (int i=0; i <JOINTPOINTERMATH_POOL_MAGAZINE_SIZE / 2; i++)
+				{
+					Bucket->Blocks.push_back(Slot.Blocks[--Slot.Count]);
+				}
+			}
+		}
+		Slot.Blocks[Slot.Count++] = Memory;
+	}
+
+	void Trim()
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		for (auto& It : Buckets)
+		{
+			for (JointPoolBucket_t* Bucket = It.second; Bucket != nullptr; Bucket = Bucket->Next)
+			{
+				for (void* Block : Bucket->Blocks)
+				{
+					BlockFree((char*)Block - Bucket->HeaderSize);
+				}
+				Bucket->Blocks.clear();
+				Bucket->Blocks.shrink_to_fit();
+			}
+		}
+	}
+
+	// Called with the registry locked, when a thread that used this pool exits.
+	void ReturnCache(JointPoolCache_t* Cache)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		for (JointPoolCache_t::Slot_t& Slot : Cache->Slots)
+		{
+			FlushSlot(Slot);
+			Slot.Bucket = nullptr;
+		}
+		SpareCaches.push_back(Cache);
+	}
+
+private:
+	static uint64_t HashLayout(int Num, const JointPointer_t* Elems)
+	{
+		// FNV-1a over the size, alignment and flags of every section.
+		uint64_t Hash = 14695981039346656037ull;
+		for (int i=0; i <Num; i++)
+		{
+			uint64_t Words[3] = { Elems[i].Size, Elems[i].Alignment, Elems[i].Flags };
+			for (uint64_t Word : Words)
+			{
+				Hash = (Hash ^ Word) * 1099511628211ull;
+			}
+		}
+		return Hash;
+	}
+
+	JointPoolCache_t* ThreadCache()
+	{
+		JointPoolThreadState_t& State = JointPoolThreadState();
+		for (const JointPoolThreadState_t::Entry_t& Entry : State.Entries)
+		{
+			if (Entry.PoolId == Id)
+			{
+				return Entry.Cache;
+			}
+		}
+
+		JointPoolCache_t* Cache;
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			if (!SpareCaches.empty())
+			{
+				Cache = SpareCaches.back();
+				SpareCaches.pop_back();
+			}
+			else
+			{
+				Cache = new JointPoolCache_t();
+				memset(Cache, 0, sizeof(JointPoolCache_t));
+				Caches.push_back(Cache);
+			}
+		}
+		JointPoolThreadState_t::Entry_t Entry;
+		Entry.PoolId = Id;
+		Entry.Cache = Cache;
+		State.Entries.push_back(Entry);
+		return Cache;
+	}
+
+	// The following are called with Mutex locked.
+	JointPoolBucket_t* FindBucket(uint64_t Hash, int Num, const JointPointer_t* Elems, size_t TotalSize)
+	{
+		JointPoolBucket_t*& Head = Buckets[Hash];
+		for (JointPoolBucket_t* Bucket = Head; Bucket != nullptr; Bucket = Bucket->Next)
+		{
+			if (Bucket->Matches(Hash, Num, Elems))
+			{
+				return Bucket;
+			}
+		}
+		JointPoolBucket_t* Bucket = new JointPoolBucket_t();
+		Bucket->Next = Head;
+		Bucket->Hash = Hash;
+		for (int i=0; i <Num; i++)
+		{
+			Bucket->Signature.push_back(Elems[i].Size);
+			Bucket->Signature.push_back(Elems[i].Alignment);
+			Bucket->Signature.push_back(Elems[i].Flags);
+		}
+		Bucket->TotalSize = TotalSize;
+		Bucket->Alignment = JointPointerMaxAlignment(Num, Elems);
+		if (Bucket->Alignment < std::alignment_of<JointPoolBucket_t*>::value)
+		{
+			Bucket->Alignment = std::alignment_of<JointPoolBucket_t*>::value;
+		}
+		Bucket->HeaderSize = JointAlignUp(sizeof(JointPoolBucket_t*), Bucket->Alignment);
+		Head = Bucket;
+		return Bucket;
+	}
+
+	void FlushSlot(JointPoolCache_t::Slot_t& Slot)
+	{
+		for (int i=0; i <Slot.Count; i++)
+		{
+			Slot.Bucket->Blocks.push_back(Slot.Blocks[i]);
+		}
+		Slot.Count = 0;
+	}
+};
+
+inline JointPoolThreadState_t::~JointPoolThreadState_t()
+{
+	JointPoolRegistry_t& Registry = JointPoolRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	for (const Entry_t& Entry : Entries)
+	{
+		for (JointPool* Pool : Registry.Pools)
+		{
+			if (Pool->Id == Entry.PoolId)
+			{
+				Pool->ReturnCache(Entry.Cache);
+				break;
+			}
+		}
+	}
+}
+
+// Index of the CPU the calling thread is running on. Without sched_getcpu, each thread gets a fixed
+// pseudo-CPU instead, which still spreads threads over the per-CPU stacks.
+inline unsigned int JointCurrentCpu()
+{
+#if defined(__linux__)
+	int Cpu = sched_getcpu();
+	if (Cpu >= 0)
+	{
+		return (unsigned int)Cpu;
+	}
+#endif
+	static std::atomic<unsigned int> NextThread(0);
+	static thread_local unsigned int ThreadCpu = NextThread.fetch_add(1, std::memory_order_relaxed);
+	return ThreadCpu;
+}
+
+struct JointConcurrentStack_t
+{
+	alignas(JOINTPOINTERMATH_CACHE_LINE_SIZE) std::atomic<uint64_t> Head; // Tag in the high half, index + 1 in the low half.
+	std::atomic<int> Count;
+};
+
+struct JointConcurrentPool
+{
+	static const unsigned int FirstSegmentBlocks = 64;
+	static const unsigned int MaxSegments = 26; // Keeps every index below 2^32 - 1.
+
+	void* (*SegmentAlloc)(size_t Size, size_t Alignment);
+	void (*SegmentFree)(void* Memory);
+	size_t TotalSize;
+	size_t PayloadSize; // Sum of the section sizes, for the stats.
+	int NumSections;
+	size_t Alignment;
+	size_t HeaderSize;
+	size_t Stride;
+	unsigned int NumStacks;
+	JointConcurrentStack_t* Stacks; // NumStacks per-CPU stacks, followed by the shared one.
+	std::atomic<char*> Segments[MaxSegments];
+	std::atomic<std::atomic<uint32_t>*> Links[MaxSegments];
+	std::atomic<unsigned int> NumSegments;
+	std::mutex GrowMutex;
+
+	JointConcurrentPool(int Num, JointPointer_t* Elems, void* (*Alloc)(size_t Size, size_t Alignment) = JointAlignedMalloc, void (*FreeFn)(void* Memory) = JointAlignedFree)
+	{
+		JOINTPOINTERMATH_ASSERT(Num > 0);
+		JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+		JOINTPOINTERMATH_ASSERT(Alloc != nullptr && FreeFn != nullptr);
+		SegmentAlloc = Alloc;
+		SegmentFree = FreeFn;
+		TotalSize = JointPointerTotalSize(Num, Elems);
+		PayloadSize = JointStatsPayload(Num, Elems);
+		NumSections = Num;
+		Alignment = JointPointerMaxAlignment(Num, Elems);
+		if (Alignment < std::alignment_of<uint32_t>::value)
+		{
+			Alignment = std::alignment_of<uint32_t>::value;
+		}
+		HeaderSize = JointAlignUp(sizeof(uint32_t), Alignment);
+		Stride = JointAlignUp(HeaderSize + TotalSize, Alignment);
+
+		unsigned int Cpus = std::thread::hardware_concurrency();
+		NumStacks = 1;
+		while (NumStacks < Cpus)
+		{
+			NumStacks *= 2;
+		}
+		Stacks = (JointConcurrentStack_t*)JointAlignedMalloc(sizeof(JointConcurrentStack_t) * (NumStacks + 1), std::alignment_of<JointConcurrentStack_t>::value);
+		JOINTPOINTERMATH_ASSERT(Stacks != nullptr);
+		for (unsigned int i=0; i <= NumStacks; i++)
+		{
+			new (&Stacks[i]) JointConcurrentStack_t();
+			Stacks[i].Head.store(0, std::memory_order_relaxed);
+			Stacks[i].Count.store(0, std::memory_order_relaxed);
+		}
+		for (unsigned int i=0; i <MaxSegments; i++)
+		{
+			Segments[i].store(nullptr, std::memory_order_relaxed);
+			Links[i].store(nullptr, std::memory_order_relaxed);
+		}
+		NumSegments.store(0, std::memory_order_relaxed);
+	}
+
+	~JointConcurrentPool()
+	{
+		unsigned int Count = NumSegments.load(std::memory_order_relaxed);
+		for (unsigned int i=0; i <Count; i++)
+		{
+			SegmentFree(Segments[i].load(std::memory_order_relaxed));
+			delete[] Links[i].load(std::memory_order_relaxed);
+		}
+		for (unsigned int i=0; i <= NumStacks; i++)
+		{
+			Stacks[i].~JointConcurrentStack_t();
+		}
+		JointAlignedFree(Stacks);
+	}
+
+	JointConcurrentPool(const JointConcurrentPool&) = delete;
+	JointConcurrentPool& operator=(const JointConcurrentPool&) = delete;
+
+	void* Allocate()
+	{
+		void* Memory = AllocateBlock();
+		JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, NumSections, PayloadSize);
+		return Memory;
+	}
+
+	void* Allocate(int Num, JointPointer_t* Elems)
+	{
+		void* Memory = Allocate();
+		if (Memory != nullptr)
+		{
+			JointPointerWrite(Memory, Num, Elems);
+			JointPointerClearPadding(Memory, Num, Elems);
+		}
+		return Memory;
+	}
+
+	void Free(void* Memory)
+	{
+		if (Memory == nullptr)
+		{
+			return;
+		}
+		JOINTPOINTERMATH_STATS_FREE(Memory, TotalSize);
+		uint32_t Index = ((uint32_t*)Memory)[-1];
+		JointConcurrentStack_t& Local = Stacks[JointCurrentCpu() & (NumStacks - 1)];
+		if (Local.Count.load(std::memory_order_relaxed) < JOINTPOINTERMATH_CONCURRENT_POOL_CPU_CAPACITY)
+		{
+			Local.Count.fetch_add(1, std::memory_order_relaxed);
+			Push(Local, Index);
+		}
+		else
+		{
+			Push(Stacks[NumStacks], Index);
+		}
+	}
+
+private:
+	void* AllocateBlock()
+	{
+		unsigned int Cpu = JointCurrentCpu() & (NumStacks - 1);
+		uint32_t Index;
+		if (Pop(Stacks[Cpu], &Index))
+		{
+			Stacks[Cpu].Count.fetch_sub(1, std::memory_order_relaxed);
+			return Block(Index);
+		}
+		if (Pop(Stacks[NumStacks], &Index))
+		{
+			return Block(Index);
+		}
+		for (unsigned int i=1; i <NumStacks; i++)
+		{
+			JointConcurrentStack_t& Victim = Stacks[(Cpu + i) & (NumStacks - 1)];
+			if (Pop(Victim, &Index))
+			{
+				Victim.Count.fetch_sub(1, std::memory_order_relaxed);
+				return Block(Index);
+			}
+		}
+		return Grow();
+	}
+
+	static unsigned int SegmentOf(uint32_t Index)
+	{
+		return JointLog2(Index / FirstSegmentBlocks + 1);
+	}
+
+	static uint32_t SegmentBegin(unsigned int Segment)
+	{
+		return FirstSegmentBlocks * ((1u << Segment) - 1);
+	}
+
+	char* Block(uint32_t Index) const
+	{
+		unsigned int Segment = SegmentOf(Index);
+		return Segments[Segment].load(std::memory_order_acquire) + (size_t)(Index - SegmentBegin(Segment)) * Stride + HeaderSize;
+	}
+
+	std::atomic<uint32_t>& Link(uint32_t Index) const
+	{
+		unsigned int Segment = SegmentOf(Index);
+		return Links[Segment].load(std::memory_order_acquire)[Index - SegmentBegin(Segment)];
+	}
+
+	void Push(JointConcurrentStack_t& Stack, uint32_t Index)
+	{
+		uint64_t Old = Stack.Head.load(std::memory_order_relaxed);
+		uint64_t New;
+		do
+		{
+			Link(Index).store((uint32_t)Old, std::memory_order_relaxed);
+			New = (((Old >> 32) + 1) << 32) | (Index + 1);
+		} while (!Stack.Head.compare_exchange_weak(Old, New, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	bool Pop(JointConcurrentStack_t& Stack, uint32_t* OutIndex)
+	{
+		uint64_t Old = Stack.Head.load(std::memory_order_acquire);
+		while ((uint32_t)Old != 0)
+		{
+			uint32_t Index = (uint32_t)Old - 1;
+			uint64_t New = (((Old >> 32) + 1) << 32) | Link(Index).load(std::memory_order_relaxed);
+			if (Stack.Head.compare_exchange_weak(Old, New, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				*OutIndex = Index;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void* Grow()
+	{
+		std::lock_guard<std::mutex> Lock(GrowMutex);
+
+		// Another thread may have grown the pool while we waited.
+		uint32_t Index;
+		if (Pop(Stacks[NumStacks], &Index))
+		{
+			return Block(Index);
+		}
+
+		unsigned int Segment = NumSegments.load(std::memory_order_relaxed);
+		if (Segment == MaxSegments)
+		{
+			return nullptr;
+		}
+		uint32_t Count = FirstSegmentBlocks << Segment;
+		if (Stride > std::numeric_limits<size_t>::max() / Count)
+		{
+			return nullptr;
+		}
+		char* Memory = (char*)SegmentAlloc(Stride * Count, Alignment);
+		if (Memory == nullptr)
+		{
+			return nullptr;
+		}
+		std::atomic<uint32_t>* SegmentLinks = new std::atomic<uint32_t>[Count];
+		uint32_t Begin = SegmentBegin(Segment);
+		for (uint32_t i=0; i <Count; i++)
+		{
+			((uint32_t*)(Memory + (size_t)i * Stride + HeaderSize))[-1] = Begin + i;
+		}
+		Segments[Segment].store(Memory, std::memory_order_release);
+		Links[Segment].store(SegmentLinks, std::memory_order_release);
+		NumSegments.store(Segment + 1, std::memory_order_release);
+
+		// Keep the first block, share the rest.
+		for (uint32_t i=Count - 1; i > 0; i--)
+		{
+			Push(Stacks[NumStacks], Begin + i);
+		}
+		return Block(Begin);
+	}
+};
+
+struct JointLayoutPlan
+{
+	JointLayoutPlan(int Num, const JointPointer_t* Elems)
+	{
+		JOINTPOINTERMATH_ASSERT(Num > 0);
+		JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+		Build(Elems, Elems + Num);
+	}
+
+	JointLayoutPlan(std::initializer_list<JointPointer_t> ini)
+	{
+		JOINTPOINTERMATH_ASSERT(ini.size() > 0);
+		Build(ini.begin(), ini.end());
+	}
+
+	int Num() const
+	{
+		return (int)Offsets.size();
+	}
+
+	size_t TotalSize() const
+	{
+		return Total;
+	}
+
+	size_t Alignment() const
+	{
+		return MaxAlignment;
+	}
+
+	// Sum of the section sizes, without alignment padding.
+	size_t PayloadSize() const
+	{
+		return Payload;
+	}
+
+	size_t Offset(int Index) const
+	{
+		JOINTPOINTERMATH_ASSERT(Index >= 0 && Index < Num());
+		return Offsets[Index];
+	}
+
+	const size_t* OffsetData() const
+	{
+		return Offsets.data();
+	}
+
+	// Zero-fills the tail padding and slack of sections with a JOINTPOINTER_PAD_ flag.
+	void ClearPadding(void* Memory) const
+	{
+		if (Memory == nullptr)
+		{
+			return;
+		}
+		for (size_t i=0; i <Padding.size(); i += 2)
+		{
+			memset(((char*)Memory) + Padding[i], 0, Padding[i + 1]);
+		}
+	}
+
+private:
+	std::vector<size_t> Offsets;
+	std::vector<size_t> Padding; // Pairs of (start, length) of the tail padding to clear.
+	size_t Total;
+	size_t Payload;
+	size_t MaxAlignment;
+
+	void Build(const JointPointer_t* Begin, const JointPointer_t* End)
+	{
+		Offsets.reserve(End - Begin);
+		Total = 0;
+		Payload = 0;
+		MaxAlignment = 1;
+		for (const JointPointer_t* Elem = Begin; Elem != End; Elem++)
+		{
+			JOINTPOINTERMATH_ASSERT(Elem->Alignment > 0 && (Elem->Alignment & (Elem->Alignment - 1)) == 0);
+			Total = JointAlignUp(Total, JointPointerAlignmentOf(*Elem));
+			Offsets.push_back(Total);
+			if (JointPointerPaddingOf(*Elem) != 0)
+			{
+				Padding.push_back(Total + Elem->Size);
+				Padding.push_back(JointPointerPaddedSize(*Elem) - Elem->Size);
+			}
+			Total += JointPointerExtentOf(*Elem);
+			Payload += Elem->Size;
+			MaxAlignment = JointPointerAlignmentOf(*Elem) > MaxAlignment ? JointPointerAlignmentOf(*Elem) : MaxAlignment;
+		}
+	}
+};
+
+inline void JointPointerWrite(void* Memory, const JointLayoutPlan& Plan, void*** Dests)
+{
+	JOINTPOINTERMATH_ASSERT(Dests != nullptr);
+	const size_t* Offsets = Plan.OffsetData();
+	for (int i=0; i <Plan.Num(); i++)
+	{
+		*Dests[i] = ((char*)Memory) + Offsets[i];
+	}
+}
+
+template<typename AllocT> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, const JointLayoutPlan& Plan, void*** Dests)
+{
+	JOINTPOINTERMATH_TRACE_START(Trace);
+	if (OutSize != nullptr)
+	{
+		*OutSize = Plan.TotalSize();
+	}
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_LAYOUT);
+	void* Memory = JointAllocatorAllocate(Alloc, Plan.TotalSize(), Plan.Alignment());
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_ALLOCATE);
+	JointPointerWrite(Memory, Plan, Dests);
+	Plan.ClearPadding(Memory);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_WRITE);
+	JOINTPOINTERMATH_TRACE_FINISH(Trace, Memory, Plan.TotalSize(), Plan.Num());
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, Plan.TotalSize(), Plan.Num(), Plan.PayloadSize());
+	return Memory;
+}
+
+inline void JointPlanWrite(char*, const size_t*)
+{
+}
+
+template<typename T, typename... Rest> void JointPlanWrite(char* Memory, const size_t* Offsets, T** Dest, Rest... Dests)
+{
+	*Dest = (T*)(Memory + *Offsets);
+	JointPlanWrite(Memory, Offsets + 1, Dests...);
+}
+
+template<typename AllocT, typename... Ts> void* JointPointerAllocate(size_t* OutSize, AllocT&& Alloc, const JointLayoutPlan& Plan, Ts**... Dests)
+{
+	JOINTPOINTERMATH_ASSERT(Plan.Num() == (int)sizeof...(Ts));
+	JOINTPOINTERMATH_TRACE_START(Trace);
+	if (OutSize != nullptr)
+	{
+		*OutSize = Plan.TotalSize();
+	}
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_LAYOUT);
+	void* Memory = JointAllocatorAllocate(Alloc, Plan.TotalSize(), Plan.Alignment());
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_ALLOCATE);
+	JointPlanWrite((char*)Memory, Plan.OffsetData(), Dests...);
+	Plan.ClearPadding(Memory);
+	JOINTPOINTERMATH_TRACE_PHASE(Trace, JOINTPOINTER_TRACE_WRITE);
+	JOINTPOINTERMATH_TRACE_FINISH(Trace, Memory, Plan.TotalSize(), Plan.Num());
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, Plan.TotalSize(), Plan.Num(), Plan.PayloadSize());
+	return Memory;
+}
+
+inline size_t JointPointerBatchStride(int Num, JointPointer_t* Elems)
+{
+	size_t TotalSize = JointPointerTotalSize(Num, Elems);
+	return JointAlignUp(TotalSize, JointPointerMaxAlignment(Num, Elems));
+}
+
+inline void JointPointerWriteBatch(void* Memory, size_t Stride, size_t Count, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+	for (int i=0; i <Num; i++)
+	{
+		char** Dest = (char**)Elems[i].Pointer;
+		char* Section = ((char*)Memory) + Elems[i].Offset;
+		for (size_t Block=0; Block <Count; Block++)
+		{
+			Dest[Block] = Section + Block * Stride;
+		}
+	}
+}
+
+template<typename AllocT> void* JointPointerAllocateBatch(size_t* OutSize, size_t* OutStride, AllocT&& Alloc, size_t Count, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Count > 0);
+	size_t Stride = JointPointerBatchStride(Num, Elems);
+	if (Stride != 0 && Count > std::numeric_limits<size_t>::max() / Stride)
+	{
+		return nullptr;
+	}
+	if (OutSize != nullptr)
+	{
+		*OutSize = Stride * Count;
+	}
+	if (OutStride != nullptr)
+	{
+		*OutStride = Stride;
+	}
+	void* Memory = JointAllocatorAllocate(Alloc, Stride * Count, JointPointerMaxAlignment(Num, Elems));
+	JointPointerWriteBatch(Memory, Stride, Count, Num, Elems);
+	for (size_t Block=0; Memory != nullptr && Block <Count; Block++)
+	{
+		JointPointerClearPadding(((char*)Memory) + Block * Stride, Num, Elems);
+	}
+	JOINTPOINTERMATH_STATS_ALLOCATE(Memory, Stride * Count, Count * Num, Count * JointStatsPayload(Num, Elems));
+	return Memory;
+}
+
+template<typename AllocT, int Num> void* JointPointerAllocateBatch(size_t* OutSize, size_t* OutStride, AllocT&& Alloc, size_t Count, JointPointer_t (&Arr)[Num])
+{
+	return JointPointerAllocateBatch(OutSize, OutStride, Alloc, Count, Num, Arr);
+}
+
+#if JOINTPOINTERMATH_HAS_MMAP
+
+struct JointMapRegion_t
+{
+	size_t Length;
+	size_t Alignment;   // Alignment of the mapping.
+	size_t Granularity; // Length is a multiple of this.
+};
+
+// The mappings made by JointMapAllocate, by address. Mapping is a system call anyway, so the lock costs little,
+// and keeping the lengths here leaves the buffer at the start of its mapping.
+struct JointMapRegistry_t
+{
+	std::mutex Mutex;
+	std::unordered_map<void*, JointMapRegion_t> Regions;
+};
+
+inline JointMapRegistry_t& JointMapRegistry()
+{
+	// Never destroyed, so buffers can still be freed by static destructors.
+	static JointMapRegistry_t* Registry = new JointMapRegistry_t();
+	return *Registry;
+}
+
+inline bool JointMapFind(void* Memory, JointMapRegion_t* Out)
+{
+	JointMapRegistry_t& Registry = JointMapRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	auto It = Registry.Regions.find(Memory);
+	if (It == Registry.Regions.end())
+	{
+		return false;
+	}
+	*Out = It->second;
+	return true;
+}
+
+inline size_t JointPageSize()
+{
+	static const size_t PageSize = (size_t)sysconf(_SC_PAGESIZE);
+	return PageSize;
+}
+
+// Maps Length bytes starting on a multiple of Alignment, by over-mapping and trimming the ends.
+// Granularity is the page size of the mapping: mappings start on it, and can only be trimmed by multiples of it,
+// which matters for MAP_HUGETLB.
+inline char* JointMapAligned(size_t Length, size_t Alignment, size_t Granularity, int ExtraFlags)
+{
+	JOINTPOINTERMATH_ASSERT(Length % Granularity == 0);
+	size_t Slack = Alignment > Granularity ? Alignment - Granularity : 0;
+	if (Length > std::numeric_limits<size_t>::max() - Slack)
+	{
+		return nullptr;
+	}
+	void* Mapping = mmap(nullptr, Length + Slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | ExtraFlags, -1, 0);
+	if (Mapping == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	char* Begin = (char*)Mapping;
+	char* Aligned = (char*)JointAlignUp((size_t)Begin, Alignment);
+	char* End = Begin + Length + Slack;
+	if ((Aligned != Begin && munmap(Begin, Aligned - Begin) != 0) || (End != Aligned + Length && munmap(Aligned + Length, End - (Aligned + Length)) != 0))
+	{
+		// Unmapping a range that is already gone succeeds, so this releases whatever is left.
+		munmap(Begin, End - Begin);
+		return nullptr;
+	}
+	return Aligned;
+}
+
+inline void JointMapPopulate(char* Base, size_t Length)
+{
+#if defined(MADV_POPULATE_WRITE)
+	if (madvise(Base, Length, MADV_POPULATE_WRITE) == 0)
+	{
+		return;
+	}
+#endif
+	for (size_t Offset=0; Offset <Length; Offset += JointPageSize())
+	{
+		((volatile char*)Base)[Offset] = 0;
+	}
+}
+
+inline void* JointMapAllocate(size_t Size, size_t Alignment, unsigned int Flags)
+{
+	JOINTPOINTERMATH_ASSERT(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+	if (Size > std::numeric_limits<size_t>::max() - JOINTPOINTERMATH_HUGE_PAGE_SIZE)
+	{
+		return nullptr;
+	}
+	Size = Size > 0 ? Size : 1;
+
+	char* Base = nullptr;
+	size_t Length = 0;
+	size_t BaseAlignment = 0;
+	size_t Granularity = 0;
+#if defined(MAP_HUGETLB)
+	if (Flags & JOINTPOINTER_MAP_HUGETLB)
+	{
+		// Huge page mappings always start on a huge page boundary.
+		Granularity = JOINTPOINTERMATH_HUGE_PAGE_SIZE;
+		BaseAlignment = Alignment > Granularity ? Alignment : Granularity;
+		Length = JointAlignUp(Size, Granularity);
+		Base = JointMapAligned(Length, BaseAlignment, Granularity, MAP_HUGETLB);
+		if (Base != nullptr && (Flags & JOINTPOINTER_MAP_POPULATE))
+		{
+			JointMapPopulate(Base, Length);
+		}
+	}
+#endif
+	if (Base == nullptr)
+	{
+		bool HugePages = (Flags & (JOINTPOINTER_MAP_HUGEPAGES | JOINTPOINTER_MAP_HUGETLB)) != 0;
+		Granularity = HugePages ? JOINTPOINTERMATH_HUGE_PAGE_SIZE : JointPageSize();
+		BaseAlignment = Alignment > Granularity ? Alignment : Granularity;
+		Length = JointAlignUp(Size, Granularity);
+		Base = JointMapAligned(Length, BaseAlignment, JointPageSize(), 0);
+		if (Base == nullptr)
+		{
+			return nullptr;
+		}
+#if defined(MADV_HUGEPAGE)
+		if (HugePages)
+		{
+			madvise(Base, Length, MADV_HUGEPAGE);
+		}
+#endif
+		if (Flags & JOINTPOINTER_MAP_POPULATE)
+		{
+			JointMapPopulate(Base, Length);
+		}
+	}
+	if (Flags & JOINTPOINTER_MAP_LOCK)
+	{
+		mlock(Base, Length);
+	}
+
+	JointMapRegion_t Region;
+	Region.Length = Length;
+	Region.Alignment = BaseAlignment;
+	Region.Granularity = Granularity;
+	JointMapRegistry_t& Registry = JointMapRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	Registry.Regions[Base] = Region;
+	return Base;
+}
+
+inline void* JointMapAlloc(size_t Size, size_t Alignment)
+{
+	return JointMapAllocate(Size, Alignment, JOINTPOINTERMATH_MAP_DEFAULT_FLAGS);
+}
+
+inline void JointMapFree(void* Memory)
+{
+	if (Memory == nullptr)
+	{
+		return;
+	}
+	size_t Length;
+	{
+		JointMapRegistry_t& Registry = JointMapRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		auto It = Registry.Regions.find(Memory);
+		JOINTPOINTERMATH_ASSERT(It != Registry.Regions.end());
+		if (It == Registry.Regions.end())
+		{
+			return;
+		}
+		Length = It->second.Length;
+		Registry.Regions.erase(It);
+	}
+	int Result = munmap(Memory, Length);
+	JOINTPOINTERMATH_ASSERT(Result == 0);
+	(void)Result;
+}
+
+#if defined(__linux__)
+inline void* JointMapReallocate(void* Memory, size_t Size)
+{
+	JOINTPOINTERMATH_ASSERT(Memory != nullptr);
+	JointMapRegion_t Region;
+	bool Found = JointMapFind(Memory, &Region);
+	JOINTPOINTERMATH_ASSERT(Found);
+	if (!Found)
+	{
+		return nullptr;
+	}
+	if (Size > std::numeric_limits<size_t>::max() - Region.Granularity)
+	{
+		return nullptr;
+	}
+	size_t Length = JointAlignUp(Size > 0 ? Size : 1, Region.Granularity);
+	if (Length == Region.Length)
+	{
+		return Memory;
+	}
+
+	char* Base = (char*)mremap(Memory, Region.Length, Length, 0);
+	if (Base == (char*)MAP_FAILED)
+	{
+		// Can't grow in place: reserve an aligned range and move the pages into it.
+		if (Length > std::numeric_limits<size_t>::max() - Region.Alignment)
+		{
+			return nullptr;
+		}
+		void* Reserved = mmap(nullptr, Length + Region.Alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (Reserved == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		char* Begin = (char*)Reserved;
+		char* End = Begin + Length + Region.Alignment;
+		char* Target = (char*)JointAlignUp((size_t)Begin, Region.Alignment);
+		Base = (char*)mremap(Memory, Region.Length, Length, MREMAP_MAYMOVE | MREMAP_FIXED, Target);
+		if (Target != Begin)
+		{
+			munmap(Begin, Target - Begin);
+		}
+		if (Target + Length != End)
+		{
+			munmap(Target + Length, End - (Target + Length));
+		}
+		if (Base == (char*)MAP_FAILED)
+		{
+			munmap(Target, Length);
+			return nullptr;
+		}
+	}
+
+	JointMapRegistry_t& Registry = JointMapRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	Registry.Regions.erase(Memory);
+	Region.Length = Length;
+	Registry.Regions[Base] = Region;
+	return Base;
+}
+#endif
+
+#endif
+
+#if JOINTPOINTERMATH_HAS_MMAP
+
+#if defined(__linux__)
+// Enough for JOINTPOINTERMATH_NUMA_MAX_NODES nodes.
+struct JointNumaMask_t
+{
+	unsigned long Bits[(JOINTPOINTERMATH_NUMA_MAX_NODES + std::numeric_limits<unsigned long>::digits - 1) / std::numeric_limits<unsigned long>::digits];
+};
+
+inline bool JointNumaAllowedNodes(JointNumaMask_t* Mask)
+{
+	const int MPOL_F_MEMS_ALLOWED_ = 1 << 2;
+	int Mode = 0;
+	memset(Mask, 0, sizeof(JointNumaMask_t));
+	return syscall(SYS_get_mempolicy, &Mode, Mask->Bits, (unsigned long)JOINTPOINTERMATH_NUMA_MAX_NODES + 1, nullptr, (unsigned long)MPOL_F_MEMS_ALLOWED_) == 0;
+}
+#endif
+
+inline int JointNumaCurrentNode()
+{
+#if defined(__linux__)
+	unsigned int Cpu = 0;
+	unsigned int Node = 0;
+	if (syscall(SYS_getcpu, &Cpu, &Node, nullptr) == 0)
+	{
+		return (int)Node;
+	}
+#endif
+	return 0;
+}
+
+inline int JointNumaNodeCount()
+{
+#if defined(__linux__)
+	JointNumaMask_t Mask;
+	if (JointNumaAllowedNodes(&Mask))
+	{
+		int Count = 0;
+		for (unsigned long Word : Mask.Bits)
+		{
+			for (; Word != 0; Word &= Word - 1)
+			{
+				Count++;
+			}
+		}
+		return Count > 0 ? Count : 1;
+	}
+#endif
+	return 1;
+}
+
+inline void* JointNumaAllocate(size_t Size, size_t Alignment, int Node, unsigned int Flags)
+{
+	JOINTPOINTERMATH_ASSERT(Node >= 0 || Node == JOINTPOINTER_NUMA_LOCAL || Node == JOINTPOINTER_NUMA_INTERLEAVE);
+
+	// Populating and locking have to wait until the policy is in place.
+	void* Memory = JointMapAllocate(Size, Alignment, Flags & ~(JOINTPOINTER_MAP_POPULATE | JOINTPOINTER_MAP_LOCK));
+	if (Memory == nullptr)
+	{
+		return nullptr;
+	}
+	JointMapRegion_t Region;
+	JointMapFind(Memory, &Region);
+
+#if defined(__linux__)
+	const int MPOL_BIND_ = 2;
+	const int MPOL_INTERLEAVE_ = 3;
+	const unsigned int MPOL_MF_MOVE_ = 1 << 1; // Nothing has been touched yet, but move any page that has.
+	JointNumaMask_t Mask;
+	int Mode = MPOL_BIND_;
+	bool HaveMask = true;
+	if (Node == JOINTPOINTER_NUMA_INTERLEAVE)
+	{
+		Mode = MPOL_INTERLEAVE_;
+		HaveMask = JointNumaAllowedNodes(&Mask);
+	}
+	else
+	{
+		if (Node == JOINTPOINTER_NUMA_LOCAL)
+		{
+			Node = JointNumaCurrentNode();
+		}
+		const int BitsPerWord = std::numeric_limits<unsigned long>::digits;
+		memset(&Mask, 0, sizeof(Mask));
+		HaveMask = Node < JOINTPOINTERMATH_NUMA_MAX_NODES;
+		if (HaveMask)
+		{
+			Mask.Bits[Node / BitsPerWord] = 1ul << (Node % BitsPerWord);
+		}
+	}
+	if (HaveMask)
+	{
+		// A failure leaves the default policy in place, which is what we want on machines without NUMA.
+		syscall(SYS_mbind, Memory, Region.Length, (unsigned long)Mode, Mask.Bits, (unsigned long)JOINTPOINTERMATH_NUMA_MAX_NODES + 1, MPOL_MF_MOVE_);
+	}
+#else
+	(void)Node;
+#endif
+
+	if (Flags & JOINTPOINTER_MAP_POPULATE)
+	{
+		JointMapPopulate((char*)Memory, Region.Length);
+	}
+	if (Flags & JOINTPOINTER_MAP_LOCK)
+	{
+		mlock(Memory, Region.Length);
+	}
+	return Memory;
+}
+
+inline void* JointNumaAllocLocal(size_t Size, size_t Alignment)
+{
+	return JointNumaAllocate(Size, Alignment, JOINTPOINTER_NUMA_LOCAL, JOINTPOINTERMATH_MAP_DEFAULT_FLAGS);
+}
+
+inline void* JointNumaAllocInterleaved(size_t Size, size_t Alignment)
+{
+	return JointNumaAllocate(Size, Alignment, JOINTPOINTER_NUMA_INTERLEAVE, JOINTPOINTERMATH_MAP_DEFAULT_FLAGS);
+}
+
+#endif
+
+struct JointImageHeader_t
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderSize;  // sizeof(JointImageHeader_t)
+	uint32_t NumSections;
+	uint64_t DataOffset;  // From the start of the file.
+	uint64_t TotalSize;
+};
+
+struct JointImageSection_t
+{
+	uint64_t Offset;      // From the start of the data.
+	uint64_t Size;
+	uint64_t Alignment;
+	char Name[JOINTPOINTERMATH_IMAGE_NAME_SIZE];
+};
+
+struct JointImage
+{
+	void* Mapping;
+	size_t MappingSize;
+	const JointImageHeader_t* Header;
+	const JointImageSection_t* Sections;
+	char* Data;
+};
+
+inline bool JointImageSave(const char* Path, const void* Memory, int Num, const JointPointer_t* Elems, const char* const* Names)
+{
+	JOINTPOINTERMATH_ASSERT(Path != nullptr);
+	JOINTPOINTERMATH_ASSERT(Memory != nullptr);
+	JOINTPOINTERMATH_ASSERT(Num > 0);
+	JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+
+	JointImageHeader_t Header;
+	memset(&Header, 0, sizeof(Header));
+	Header.Magic = JOINTPOINTERMATH_IMAGE_MAGIC;
+	Header.Version = JOINTPOINTERMATH_IMAGE_VERSION;
+	Header.HeaderSize = sizeof(JointImageHeader_t);
+	Header.NumSections = (uint32_t)Num;
+	Header.DataOffset = JointAlignUp(sizeof(JointImageHeader_t) + sizeof(JointImageSection_t) * Num, JOINTPOINTERMATH_IMAGE_DATA_ALIGNMENT);
+	for (int i=0; i <Num; i++)
+	{
+		if (Elems[i].Offset + Elems[i].Size > Header.TotalSize)
+		{
+			Header.TotalSize = Elems[i].Offset + Elems[i].Size;
+		}
+	}
+
+	FILE* File = fopen(Path, "wb");
+	if (File == nullptr)
+	{
+		return false;
+	}
+	bool Ok = fwrite(&Header, sizeof(Header), 1, File) == 1;
+	for (int i=0; Ok && i <Num; i++)
+	{
+		JointImageSection_t Section;
+		memset(&Section, 0, sizeof(Section));
+		Section.Offset = Elems[i].Offset;
+		Section.Size = Elems[i].Size;
+		Section.Alignment = Elems[i].Alignment;
+		if (Names != nullptr && Names[i] != nullptr)
+		{
+			strncpy(Section.Name, Names[i], sizeof(Section.Name) - 1);
+		}
+		Ok = fwrite(&Section, sizeof(Section), 1, File) == 1;
+	}
+	for (long Pad = (long)(Header.DataOffset - sizeof(Header) - sizeof(JointImageSection_t) * Num); Ok && Pad > 0; Pad--)
+	{
+		Ok = fputc(0, File) != EOF;
+	}
+	if (Ok && Header.TotalSize > 0)
+	{
+		Ok = fwrite(Memory, (size_t)Header.TotalSize, 1, File) == 1;
+	}
+	Ok = fclose(File) == 0 && Ok;
+	return Ok;
+}
+
+#if JOINTPOINTERMATH_HAS_MMAP
+
+inline void JointImageUnload(JointImage* Image)
+{
+	JOINTPOINTERMATH_ASSERT(Image != nullptr);
+	if (Image->Mapping != nullptr)
+	{
+		munmap(Image->Mapping, Image->MappingSize);
+	}
+	memset(Image, 0, sizeof(JointImage));
+}
+
+inline bool JointImageLoad(JointImage* Image, const char* Path, int Num, JointPointer_t* Elems)
+{
+	JOINTPOINTERMATH_ASSERT(Image != nullptr);
+	JOINTPOINTERMATH_ASSERT(Path != nullptr);
+	JOINTPOINTERMATH_ASSERT(Num >= 0);
+	memset(Image, 0, sizeof(JointImage));
+
+	int File = open(Path, O_RDONLY);
+	if (File < 0)
+	{
+		return false;
+	}
+	struct stat Stat;
+	if (fstat(File, &Stat) != 0 || (uint64_t)Stat.st_size < sizeof(JointImageHeader_t))
+	{
+		close(File);
+		return false;
+	}
+	size_t FileSize = (size_t)Stat.st_size;
+	void* Mapping = mmap(nullptr, FileSize, PROT_READ, MAP_PRIVATE, File, 0);
+	close(File);
+	if (Mapping == MAP_FAILED)
+	{
+		return false;
+	}
+	Image->Mapping = Mapping;
+	Image->MappingSize = FileSize;
+
+	// Check the header and the section table before trusting any offset in them.
+	const JointImageHeader_t* Header = (const JointImageHeader_t*)Mapping;
+	bool Ok = Header->Magic == JOINTPOINTERMATH_IMAGE_MAGIC
+		&& Header->Version == JOINTPOINTERMATH_IMAGE_VERSION
+		&& Header->HeaderSize == sizeof(JointImageHeader_t)
+		&& Header->NumSections <= (FileSize - sizeof(JointImageHeader_t)) / sizeof(JointImageSection_t)
+		&& Header->DataOffset >= sizeof(JointImageHeader_t) + sizeof(JointImageSection_t) * Header->NumSections
+		&& Header->DataOffset <= FileSize
+		&& Header->TotalSize <= FileSize - Header->DataOffset;
+	if (!Ok)
+	{
+		JointImageUnload(Image);
+		return false;
+	}
+	Image->Header = Header;
+	Image->Sections = (const JointImageSection_t*)(Header + 1);
+	Image->Data = (char*)Mapping + Header->DataOffset;
+	for (uint32_t i=0; i <Header->NumSections; i++)
+	{
+		const JointImageSection_t& Section = Image->Sections[i];
+		if (Section.Offset > Header->TotalSize || Section.Size > Header->TotalSize - Section.Offset
+			|| Section.Alignment == 0 || ((size_t)(Image->Data + Section.Offset) & (Section.Alignment - 1)) != 0)
+		{
+			JointImageUnload(Image);
+			return false;
+		}
+	}
+
+	if (Num > 0)
+	{
+		JOINTPOINTERMATH_ASSERT(Elems != nullptr);
+		if ((uint32_t)Num != Header->NumSections)
+		{
+			JointImageUnload(Image);
+			return false;
+		}
+		for (int i=0; i <Num; i++)
+		{
+			const JointImageSection_t& Section = Image->Sections[i];
+			if (Section.Size != Elems[i].Size || ((size_t)(Image->Data + Section.Offset) & (Elems[i].Alignment - 1)) != 0)
+			{
+				JointImageUnload(Image);
+				return false;
+			}
+		}
+		for (int i=0; i <Num; i++)
+		{
+			Elems[i].Offset = (size_t)Image->Sections[i].Offset;
+		}
+		JointPointerWrite(Image->Data, Num, Elems);
+	}
+	return true;
+}
+
+inline void* JointImageFind(const JointImage* Image, const char* Name, size_t* OutSize)
+{
+	JOINTPOINTERMATH_ASSERT(Image != nullptr && Image->Header != nullptr);
+	JOINTPOINTERMATH_ASSERT(Name != nullptr);
+	for (uint32_t i=0; i <Image->Header->NumSections; i++)
+	{
+		const JointImageSection_t& Section = Image->Sections[i];
+		if (strncmp(Section.Name, Name, sizeof(Section.Name)) == 0)
+		{
+			if (OutSize != nullptr)
+			{
+				*OutSize = (size_t)Section.Size;
+			}
+			return Image->Data + Section.Offset;
+		}
+	}
+	return nullptr;
+}
+
+#endif
+
+template<typename T, typename OffsetT = int32_t> struct JointRelPtr
+{
+	static_assert(std::is_integral<OffsetT>::value && std::is_signed<OffsetT>::value, "JointRelPtr offsets must be signed integers");
+
+	OffsetT Offset; // From this object to the target, or 0 for null.
+
+	JointRelPtr()
+	{
+		Offset = 0;
+	}
+
+	JointRelPtr(T* Ptr)
+	{
+		Set(Ptr);
+	}
+
+	JointRelPtr(const JointRelPtr& Other)
+	{
+		Set(Other.Get());
+	}
+
+	JointRelPtr& operator=(const JointRelPtr& Other)
+	{
+		Set(Other.Get());
+		return *this;
+	}
+
+	JointRelPtr& operator=(T* Ptr)
+	{
+		Set(Ptr);
+		return *this;
+	}
+
+	T* Get() const
+	{
+		return Offset == 0 ? nullptr : (T*)((char*)this + Offset);
+	}
+
+	void Set(T* Ptr)
+	{
+		if (Ptr == nullptr)
+		{
+			Offset = 0;
+			return;
+		}
+		ptrdiff_t Distance = (char*)Ptr - (char*)this;
+		JOINTPOINTERMATH_ASSERT(Distance != 0);
+		JOINTPOINTERMATH_ASSERT((ptrdiff_t)(OffsetT)Distance == Distance);
+		Offset = (OffsetT)Distance;
+	}
+
+	// No null check, like a raw pointer.
+	T& operator*() const
+	{
+		return *(T*)((char*)this + Offset);
+	}
+
+	T* operator->() const
+	{
+		return (T*)((char*)this + Offset);
+	}
+
+	T& operator[](ptrdiff_t Index) const
+	{
+		return ((T*)((char*)this + Offset))[Index];
+	}
+
+	explicit operator bool() const
+	{
+		return Offset != 0;
+	}
+
+	operator T*() const
+	{
+		return Get();
+	}
+};
+
+template<typename T, typename OffsetT = uint32_t> struct JointOffset
+{
+	static_assert(std::is_integral<OffsetT>::value, "JointOffset offsets must be integers");
+
+	OffsetT Offset; // From the start of the buffer.
+
+	T* Get(const void* Base) const
+	{
+		return (T*)((char*)Base + Offset);
+	}
+
+	void Set(const void* Base, const T* Ptr)
+	{
+		ptrdiff_t Distance = (const char*)Ptr - (const char*)Base;
+		JOINTPOINTERMATH_ASSERT(Distance >= 0);
+		JOINTPOINTERMATH_ASSERT((uint64_t)(OffsetT)Distance == (uint64_t)Distance);
+		Offset = (OffsetT)Distance;
+	}
+};
+
+struct JointPointerSharedLine_t
+{
+	int First;
+	int Second;
+	size_t Line; // Lines from the one holding the start of the buffer.
+};
+
+inline int JointPointerSharedLines(const void* Memory, int Num, const JointPointer_t* Elems, JointPointerSharedLine_t* Out, int MaxOut)
+{
+	JOINTPOINTERMATH_ASSERT(Num >= 0);
+	JOINTPOINTERMATH_ASSERT(Num == 0 || Elems != nullptr);
+	JOINTPOINTERMATH_ASSERT(MaxOut <= 0 || Out != nullptr);
+	const size_t Line = JOINTPOINTERMATH_CACHE_LINE_SIZE;
+	size_t Base = (size_t)Memory;
+	size_t BaseLine = Base / Line;
+	int Count = 0;
+	for (int i=0; i <Num; i++)
+	{
+		if (Elems[i].Size == 0)
+		{
+			continue;
+		}
+		size_t FirstA = (Base + Elems[i].Offset) / Line;
+		size_t LastA = (Base + Elems[i].Offset + Elems[i].Size - 1) / Line;
+		for (int j=i + 1; j <Num; j++)
+		{
+			if (Elems[j].Size == 0)
+			{
+				continue;
+			}
+			size_t FirstB = (Base + Elems[j].Offset) / Line;
+			size_t LastB = (Base + Elems[j].Offset + Elems[j].Size - 1) / Line;
+			if (FirstA > LastB || FirstB > LastA)
+			{
+				continue;
+			}
+			if (Count < MaxOut)
+			{
+				Out[Count].First = i;
+				Out[Count].Second = j;
+				Out[Count].Line = (FirstA > FirstB ? FirstA : FirstB) - BaseLine;
+			}
+			Count++;
+		}
+	}
+	return Count;
+}
+
+#if JOINTPOINTERMATH_HAS_PMR
+enum JointResourceMode
+{
+	JOINTPOINTER_RESOURCE_MONOTONIC, // Deallocation does nothing.
+	JOINTPOINTER_RESOURCE_LIFO, // Deallocating the most recent allocation gives its bytes back.
+};
+
+struct JointMemoryResource : std::pmr::memory_resource
+{
+	char* Begin;
+	char* End;
+	char* Cursor;
+	JointResourceMode Mode;
+	std::pmr::memory_resource* Upstream;
+
+	JointMemoryResource(void* Memory, size_t Size, JointResourceMode M = JOINTPOINTER_RESOURCE_MONOTONIC, std::pmr::memory_resource* Up = std::pmr::null_memory_resource())
+	{
+		JOINTPOINTERMATH_ASSERT(Memory != nullptr || Size == 0);
+		JOINTPOINTERMATH_ASSERT(Up != nullptr);
+		Begin = (char*)Memory;
+		End = Begin + Size;
+		Cursor = Begin;
+		Mode = M;
+		Upstream = Up;
+	}
+
+	JointMemoryResource(const JointPointer_t& Section, JointResourceMode M = JOINTPOINTER_RESOURCE_MONOTONIC, std::pmr::memory_resource* Up = std::pmr::null_memory_resource())
+		: JointMemoryResource(*Section.Pointer, Section.Size, M, Up)
+	{
+	}
+
+	JointMemoryResource(const JointMemoryResource&) = delete;
+	JointMemoryResource& operator=(const JointMemoryResource&) = delete;
+
+	// Makes the whole section available again. Anything still using it must be gone.
+	void Release()
+	{
+		Cursor = Begin;
+	}
+
+	size_t Used() const
+	{
+		return Cursor - Begin;
+	}
+
+private:
+	void* do_allocate(size_t Bytes, size_t Alignment) override
+	{
+		size_t Offset = JointAlignUp((size_t)Cursor, Alignment) - (size_t)Begin;
+		if (Offset <= (size_t)(End - Begin) && Bytes <= (size_t)(End - Begin) - Offset)
+		{
+			Cursor = Begin + Offset + Bytes;
+			return Begin + Offset;
+		}
+		return Upstream->allocate(Bytes, Alignment);
+	}
+
+	void do_deallocate(void* Memory, size_t Bytes, size_t Alignment) override
+	{
+		bool Inside = (char*)Memory >= Begin && ((char*)Memory < End || (Bytes == 0 && (char*)Memory == End));
+		if (!Inside)
+		{
+			Upstream->deallocate(Memory, Bytes, Alignment);
+			return;
+		}
+		if (Mode == JOINTPOINTER_RESOURCE_LIFO && (char*)Memory + Bytes == Cursor)
+		{
+			Cursor = (char*)Memory;
+		}
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& Other) const noexcept override
+	{
+		return this == &Other;
+	}
+};
+#endif
+
+template<size_t N, size_t Align = std::alignment_of<std::max_align_t>::value> struct JointInline
+{
+	static_assert(N > 0, "JointInline needs at least one byte");
+	static_assert(Align > 0 && (Align & (Align - 1)) == 0, "JointInline alignment must be a power of two");
+
+	alignas(Align) unsigned char Storage[N];
+	size_t Cursor;
+
+	JointInline()
+	{
+		Cursor = 0;
+	}
+
+	JointInline(const JointInline&) = delete;
+	JointInline& operator=(const JointInline&) = delete;
+
+	void* Allocate(size_t Size, size_t Alignment)
+	{
+		JOINTPOINTERMATH_ASSERT(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+		if (Alignment > Align)
+		{
+			return nullptr;
+		}
+		size_t Offset = JointAlignUp(Cursor, Alignment);
+		if (Offset > N || Size > N - Offset)
+		{
+			return nullptr;
+		}
+		Cursor = Offset + Size;
+		return Storage + Offset;
+	}
+
+	void Reset()
+	{
+		Cursor = 0;
+	}
+};
+
+template<size_t N, size_t Align = std::alignment_of<std::max_align_t>::value> struct JointSmallBlock
+{
+	static_assert(N > 0, "JointSmallBlock needs at least one byte");
+	static_assert(Align > 0 && (Align & (Align - 1)) == 0, "JointSmallBlock alignment must be a power of two");
+
+	alignas(Align) unsigned char Storage[N];
+	void* Heap;
+
+	JointSmallBlock()
+	{
+		Heap = nullptr;
+	}
+
+	~JointSmallBlock()
+	{
+		JointAlignedFree(Heap);
+	}
+
+	JointSmallBlock(const JointSmallBlock&) = delete;
+	JointSmallBlock& operator=(const JointSmallBlock&) = delete;
+
+	// Frees the previous buffer, if it was on the heap.
+	void* Allocate(size_t Size, size_t Alignment)
+	{
+		JOINTPOINTERMATH_ASSERT(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+		JointAlignedFree(Heap);
+		Heap = nullptr;
+		if (Size <= N && Alignment <= Align)
+		{
+			return Storage;
+		}
+		Heap = JointAlignedMalloc(Size, Alignment);
+		return Heap;
+	}
+
+	bool IsInline() const
+	{
+		return Heap == nullptr;
+	}
+};
+
+struct JointLayoutBuilder
+{
+	JointLayoutBuilder()
+	{
+		Built = 0;
+		Total = 0;
+		MaxMask = 0;
+		Overflow = false;
+	}
+
+	void Reserve(size_t Num)
+	{
+		Elems.reserve(Num);
+		Masks.reserve(Num);
+		Extents.reserve(Num);
+	}
+
+	template<typename T> JointLayoutBuilder& Add(T** Ptr, size_t Count)
+	{
+		return Add(Ptr, Count, std::alignment_of<T>::value, 0);
+	}
+
+	template<typename T> JointLayoutBuilder& Add(T** Ptr, size_t Count, size_t Align, unsigned int Flags = 0)
+	{
+		JOINTPOINTERMATH_ASSERT(Ptr != nullptr);
+		if (Count > std::numeric_limits<size_t>::max() / sizeof(T))
+		{
+			Overflow = true;
+			Count = 0;
+		}
+		return Add(JointPointer_t((void**)Ptr, Count * sizeof(T), Align, Flags));
+	}
+
+	JointLayoutBuilder& Add(const JointPointer_t& Elem)
+	{
+		JOINTPOINTERMATH_ASSERT(Elem.Pointer != nullptr);
+		JOINTPOINTERMATH_ASSERT(Elem.Alignment > 0 && (Elem.Alignment & (Elem.Alignment - 1)) == 0);
+		size_t Extent = JointPointerExtentOf(Elem);
+		if (Extent < Elem.Size)
+		{
+			Overflow = true;
+		}
+		Elems.push_back(Elem);
+		Masks.push_back(JointPointerAlignmentOf(Elem) - 1);
+		Extents.push_back(Extent);
+		return *this;
+	}
+
+	size_t Num() const
+	{
+		return Elems.size();
+	}
+
+	bool Overflowed() const
+	{
+		return Overflow;
+	}
+
+	size_t TotalSize()
+	{
+		Build();
+		return Overflow ? 0 : Total;
+	}
+
+	size_t Alignment()
+	{
+		Build();
+		return MaxMask + 1;
+	}
+
+	size_t Offset(size_t Index)
+	{
+		JOINTPOINTERMATH_ASSERT(Index < Num());
+		Build();
+		return Elems[Index].Offset;
+	}
+
+	const JointPointer_t* Data()
+	{
+		Build();
+		return Elems.data();
+	}
+
+	void Write(void* Memory)
+	{
+		Build();
+		JOINTPOINTERMATH_ASSERT(!Overflow);
+		for (size_t i=0; i <Elems.size(); i++)
+		{
+			*Elems[i].Pointer = ((char*)Memory) + Elems[i].Offset;
+		}
+	}
+
+	template<typename AllocT> void* Allocate(size_t* OutSize, AllocT&& Alloc)
+	{
+		JOINTPOINTERMATH_ASSERT(Num() > 0);
+		size_t Size = TotalSize();
+		if (OutSize != nullptr)
+		{
+			*OutSize = Size;
+		}
+		if (Overflow)
+		{
+			return nullptr;
+		}
+		void* Memory = JointAllocatorAllocate(Alloc, Size, MaxMask + 1);
+		Write(Memory);
+		for (size_t i=0; i <Elems.size(); i++)
+		{
+			JointPointerClearPadding(Memory, 1, &Elems[i]);
+		}
+		JOINTPOINTERMATH_STATS_ALLOCATE(Memory, Size, Elems.size(), JointStatsPayload((int)Elems.size(), Elems.data()));
+		return Memory;
+	}
+
+	void Clear()
+	{
+		Elems.clear();
+		Masks.clear();
+		Extents.clear();
+		Built = 0;
+		Total = 0;
+		MaxMask = 0;
+		Overflow = false;
+	}
+
+private:
+	std::vector<JointPointer_t> Elems;
+	std::vector<size_t> Masks; // Alignment - 1 of each section.
+	std::vector<size_t> Extents; // Bytes each section takes up, padding included.
+	size_t Built; // Sections that have their offset.
+	size_t Total;
+	size_t MaxMask;
+	bool Overflow;
+
+	// Every offset depends on the one before it, so this can't be vectorised, but there are no branches in the loop:
+	// masks of powers of two can be combined with | to get the largest, and wrapping around is collected the same way.
+	void Build()
+	{
+		size_t Offset = Total;
+		size_t Mask = MaxMask;
+		size_t Wrapped = 0;
+		JointPointer_t* Out = Elems.data();
+		const size_t* InMasks = Masks.data();
+		const size_t* InExtents = Extents.data();
+		for (size_t i=Built; i <Elems.size(); i++)
+		{
+			size_t Aligned = (Offset + InMasks[i]) & ~InMasks[i];
+			size_t End = Aligned + InExtents[i];
+			Wrapped |= (size_t)(Aligned < Offset) | (size_t)(End < Aligned);
+			Out[i].Offset = Aligned;
+			Mask |= InMasks[i];
+			Offset = End;
+		}
+		Built = Elems.size();
+		Total = Offset;
+		MaxMask = Mask;
+		if (Wrapped != 0)
+		{
+			Overflow = true;
+		}
+	}
+};
+
+
+// Tells the compiler Ptr is a multiple of Align, so loops over it can use aligned vector loads.
+template<size_t Align, typename T> T* JointAssumeAligned(T* Ptr)
+{
+	static_assert(Align > 0 && (Align & (Align - 1)) == 0, "JointAssumeAligned alignment must be a power of two");
+#if defined(__cpp_lib_assume_aligned)
+	return std::assume_aligned<Align>(Ptr);
+#elif defined(__GNUC__) || defined(__clang__)
+	return (T*)__builtin_assume_aligned(Ptr, Align);
+#else
+	return Ptr;
+#endif
+}
+
+template<typename T, size_t Align = std::alignment_of<T>::value> struct JointSpan
+{
+	static_assert(Align >= std::alignment_of<T>::value && (Align & (Align - 1)) == 0, "JointSpan alignment must be a power of two, at least that of T");
+
+	typedef T Type;
+	static const size_t Alignment = Align;
+
+	T* Pointer;
+	size_t Count;
+
+	JointSpan() : Pointer(nullptr), Count(0)
+	{
+	}
+
+	JointSpan(T* Ptr, size_t Num) : Pointer(Ptr), Count(Num)
+	{
+	}
+
+	T* Data() const
+	{
+		return JointAssumeAligned<Align>(Pointer);
+	}
+
+	size_t Num() const
+	{
+		return Count;
+	}
+
+	T& operator[](size_t Index) const
+	{
+		JOINTPOINTERMATH_ASSERT(Index < Count);
+		return Data()[Index];
+	}
+
+	T* begin() const
+	{
+		return Data();
+	}
+
+	T* end() const
+	{
+		return Data() + Count;
+	}
+};
+
+template<typename T, size_t Align> const size_t JointSpan<T, Align>::Alignment;
+
+// Use in place of T in JointMake to align a section more than T needs, for SIMD loads.
+template<typename T, size_t Align> struct JointAligned
+{
+};
+
+template<typename T> struct JointMakeSection
+{
+	typedef T Type;
+	static const size_t Alignment = std::alignment_of<T>::value;
+};
+
+template<typename T, size_t Align> struct JointMakeSection<JointAligned<T, Align>>
+{
+	typedef T Type;
+	static const size_t Alignment = Align > std::alignment_of<T>::value ? Align : std::alignment_of<T>::value;
+};
+
+struct JointAlignedFreer
+{
+	void operator()(void* Memory) const
+	{
+		JointAlignedFree(Memory);
+	}
+};
+
+// Holds the deallocator inside the block when it has no state, so it takes no room.
+template<typename FreeT, bool Empty = std::is_empty<FreeT>::value> struct JointBlockBase_t : private FreeT
+{
+	void* Memory;
+
+	JointBlockBase_t(void* Mem, FreeT&& Free) : FreeT(std::move(Free)), Memory(Mem)
+	{
+	}
+
+	FreeT& Freer()
+	{
+		return *this;
+	}
+
+	void SetFreer(FreeT&&)
+	{
+	}
+};
+
+template<typename FreeT> struct JointBlockBase_t<FreeT, false>
+{
+	void* Memory;
+	FreeT Free;
+
+	JointBlockBase_t(void* Mem, FreeT&& F) : Memory(Mem), Free(std::move(F))
+	{
+	}
+
+	FreeT& Freer()
+	{
+		return Free;
+	}
+
+	void SetFreer(FreeT&& F)
+	{
+		Free = std::move(F);
+	}
+};
+
+// The size and alignment of a block, kept only when something needs them at free time: a sized deallocator, or
+// the stats and tracing, which see the free through JointPointerFree.
+template<bool Keep> struct JointBlockExtent_t
+{
+	size_t Size() const
+	{
+		return Total;
+	}
+
+	size_t Alignment() const
+	{
+		return MaxAlignment;
+	}
+
+protected:
+	size_t Total;
+	size_t MaxAlignment;
+
+	JointBlockExtent_t(size_t Sz, size_t Align) : Total(Sz), MaxAlignment(Align)
+	{
+	}
+
+	template<typename FreeT> void FreeBlock(FreeT& Free, void* Memory)
+	{
+		JointPointerFree(Free, Memory, Total, MaxAlignment);
+	}
+};
+
+template<> struct JointBlockExtent_t<false>
+{
+protected:
+	JointBlockExtent_t(size_t, size_t)
+	{
+	}
+
+	template<typename FreeT> void FreeBlock(FreeT& Free, void* Memory)
+	{
+		Free(Memory);
+	}
+};
+
+template<typename FreeT> struct JointBlockKeepsExtent
+{
+	static const bool Value = JointDeallocatorIsSized<FreeT>::value || JOINTPOINTERMATH_STATS || JOINTPOINTERMATH_TRACE;
+};
+
+// Owns a joint block and frees it with FreeT when destroyed. Move-only. Size() and Alignment() are only there
+// when the block keeps them (see JointBlockExtent_t).
+template<typename FreeT = JointAlignedFreer> struct JointBlock : private JointBlockBase_t<FreeT>, public JointBlockExtent_t<JointBlockKeepsExtent<FreeT>::Value>
+{
+	typedef JointBlockBase_t<FreeT> Base;
+	typedef JointBlockExtent_t<JointBlockKeepsExtent<FreeT>::Value> Extent;
+
+	JointBlock() : Base(nullptr, FreeT()), Extent(0, 1)
+	{
+	}
+
+	JointBlock(void* Mem, size_t Sz, size_t Align, FreeT F = FreeT()) : Base(Mem, std::move(F)), Extent(Sz, Align)
+	{
+	}
+
+	JointBlock(JointBlock&& Other) : Base(Other.Memory, std::move(Other.Freer())), Extent(Other)
+	{
+		Other.Memory = nullptr;
+	}
+
+	JointBlock& operator=(JointBlock&& Other)
+	{
+		if (this != &Other)
+		{
+			Reset();
+			Base::Memory = Other.Memory;
+			Extent::operator=(Other);
+			Base::SetFreer(std::move(Other.Freer()));
+			Other.Memory = nullptr;
+		}
+		return *this;
+	}
+
+	~JointBlock()
+	{
+		Reset();
+	}
+
+	JointBlock(const JointBlock&) = delete;
+	JointBlock& operator=(const JointBlock&) = delete;
+
+	void* Get() const
+	{
+		return Base::Memory;
+	}
+
+	explicit operator bool() const
+	{
+		return Base::Memory != nullptr;
+	}
+
+	// Gives up ownership without freeing. Free it the way Reset would: with JointPointerFree(Free, Memory, Size(),
+	// Alignment()) when the block keeps its size, with Free(Memory) otherwise.
+	void* Release()
+	{
+		void* Released = Base::Memory;
+		Base::Memory = nullptr;
+		return Released;
+	}
+
+	void Reset()
+	{
+		if (Base::Memory != nullptr)
+		{
+			Extent::FreeBlock(Base::Freer(), Base::Memory);
+			Base::Memory = nullptr;
+		}
+	}
+};
+
+static_assert(JointBlockKeepsExtent<JointAlignedFreer>::Value || sizeof(JointBlock<JointAlignedFreer>) == sizeof(void*), "a JointBlock with a stateless, unsized deallocator should be the size of a pointer");
+
+template<size_t... I> struct JointIndices
+{
+};
+
+template<size_t N, size_t... I> struct JointMakeIndices : JointMakeIndices<N - 1, N - 1, I...>
+{
+};
+
+template<size_t... I> struct JointMakeIndices<0, I...>
+{
+	typedef JointIndices<I...> Type;
+};
+
+template<typename FreeT, typename... Ts> struct JointMakeResult
+{
+	typedef std::tuple<JointBlock<FreeT>, JointSpan<typename JointMakeSection<Ts>::Type, JointMakeSection<Ts>::Alignment>...> Type;
+};
+
+template<typename FreeT, typename... Ts, size_t... I> typename JointMakeResult<FreeT, Ts...>::Type JointMakeTuple(JointIndices<I...>, char* Memory, size_t TotalSize, size_t Alignment, FreeT&& Free, const size_t* Offsets, const size_t* Counts)
+{
+	return typename JointMakeResult<FreeT, Ts...>::Type(JointBlock<FreeT>(Memory, TotalSize, Alignment, std::move(Free)),
+		JointSpan<typename JointMakeSection<Ts>::Type, JointMakeSection<Ts>::Alignment>(
+			Memory != nullptr ? (typename JointMakeSection<Ts>::Type*)(Memory + Offsets[I]) : nullptr, Memory != nullptr ? Counts[I] : 0)...);
+}
+
+// Lays out Counts[i] elements of each of Ts, allocates the block with Alloc, and returns it with a span per section.
+// Null block and empty spans if a size overflows or the allocator fails.
+template<typename... Ts, typename AllocT, typename FreeT, typename... CountTs> typename std::enable_if<sizeof...(CountTs) == sizeof...(Ts), typename JointMakeResult<typename std::decay<FreeT>::type, Ts...>::Type>::type
+	JointMake(AllocT&& Alloc, FreeT&& Free, CountTs... NumElems)
+{
+	static_assert(sizeof...(Ts) > 0, "JointMake needs at least one section");
+	typedef typename std::decay<FreeT>::type FreerT;
+	const size_t Counts[] = { (size_t)NumElems... };
+	const size_t Sizes[] = { sizeof(typename JointMakeSection<Ts>::Type)... };
+	const size_t Alignments[] = { JointMakeSection<Ts>::Alignment... };
+	size_t Offsets[sizeof...(Ts)];
+	size_t TotalSize = 0;
+	size_t Payload = 0;
+	bool Overflow = false;
+	for (size_t i=0; i <sizeof...(Ts); i++)
+	{
+		size_t Aligned = JointAlignUp(TotalSize, Alignments[i]);
+		Overflow = Overflow || Aligned < TotalSize || Counts[i] > std::numeric_limits<size_t>::max() / Sizes[i] || Counts[i] * Sizes[i] > std::numeric_limits<size_t>::max() - Aligned;
+		if (Overflow)
+		{
+			break;
+		}
+		Offsets[i] = Aligned;
+		TotalSize = Aligned + Counts[i] * Sizes[i];
+		Payload += Counts[i] * Sizes[i];
+	}
+	const size_t Alignment = JointMaxAlignment<JointMakeSection<Ts>::Alignment...>::Value;
+	char* Memory = nullptr;
+	if (!Overflow)
+	{
+		Memory = (char*)JointAllocatorAllocate(Alloc, TotalSize, Alignment);
+		JOINTPOINTERMATH_STATS_ALLOCATE(Memory, TotalSize, sizeof...(Ts), Payload);
+	}
+	(void)Payload;
+	return JointMakeTuple<FreerT, Ts...>(typename JointMakeIndices<sizeof...(Ts)>::Type(), Memory, TotalSize, Alignment, FreerT(std::forward<FreeT>(Free)), Offsets, Counts);
+}
+
+template<typename... Ts, typename... CountTs> typename std::enable_if<sizeof...(CountTs) == sizeof...(Ts), typename JointMakeResult<JointAlignedFreer, Ts...>::Type>::type
+	JointMake(CountTs... NumElems)
+{
+	return JointMake<Ts...>(JointAlignedMalloc, JointAlignedFreer(), NumElems...);
+}
+
 #endif
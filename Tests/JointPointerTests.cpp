@@ -0,0 +1,514 @@
+/*
+Tests for the parts of JointPointerMath that are easiest to get subtly wrong.
+
+Build and run from the repository root (there is no build system; any C++17 compiler will do). The sanitizers
+are optional but catch far more than the checks below can:
+
+	g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread -I. Tests/JointPointerTests.cpp -o JointPointerTests
+	./JointPointerTests
+	./JointPointerTests --seed 1234
+
+	g++ -std=c++17 -O1 -g -fsanitize=thread -pthread -I. Tests/JointPointerTests.cpp -o JointPointerTestsTsan
+	./JointPointerTestsTsan
+
+The tests are:
+
+	concurrent_pool		threads allocate and free JointConcurrentPool blocks, handing some of them to other
+				threads to free; no block may be handed out twice while it's still in use
+	reallocate		random layouts grown and shrunk with JointPointerReallocate must keep the contents of
+				every section (up to the smaller of the old and new sizes) and keep every alignment
+	image_load		JointImageLoad must load a good image and reject every truncation of it and a set of
+				corrupted headers and section tables; randomly corrupted headers must never crash it
+
+Every failed check is printed; the exit code is the number of failed checks (capped at 255), so 0 means success.
+*/
+
+#include "../JointPointerMath.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define JOINTTEST_CHECK(Cond) JointTestCheck((Cond), #Cond, __FILE__, __LINE__)
+
+#define JOINTTEST_MAX_SECTIONS 16
+
+static std::atomic<int> JointTestFailures(0);
+
+static bool JointTestCheck(bool Ok, const char* Expr, const char* File, int Line)
+{
+	if (!Ok)
+	{
+		// Only print the first few, a broken invariant in a loop would otherwise flood the output.
+		if (JointTestFailures.fetch_add(1) < 20)
+		{
+			fprintf(stderr, "%s:%d: check failed: %s\n", File, Line, Expr);
+		}
+	}
+	return Ok;
+}
+
+// xorshift64*, so a failing seed can be replayed on any platform.
+struct JointTestRandom
+{
+	uint64_t State;
+
+	explicit JointTestRandom(uint64_t Seed)
+	{
+		State = Seed != 0 ? Seed : 0x9e3779b97f4a7c15ull;
+	}
+
+	uint64_t Next()
+	{
+		State ^= State >> 12;
+		State ^= State << 25;
+		State ^= State >> 27;
+		return State * 0x2545f4914f6cdd1dull;
+	}
+
+	size_t Below(size_t Limit)
+	{
+		return (size_t)(Next() % Limit);
+	}
+};
+
+// --- concurrent_pool ---
+
+// The first section of every block holds JOINTTEST_LIVE plus the id of the thread that owns it, or 0 once it's
+// freed. Blocks from a new segment hold whatever the segment allocator left there, so a block is only known to be
+// in use when it has the tag; a thread that gets a tagged block has been handed one someone else is still using.
+#define JOINTTEST_LIVE 0x4c49564500000000ull
+#define JOINTTEST_IS_LIVE(Value) (((Value) & 0xffffffff00000000ull) == JOINTTEST_LIVE)
+
+struct JointTestPoolShared
+{
+	JointConcurrentPool* Pool;
+	std::mutex HandoffMutex;
+	std::vector<std::atomic<uint64_t>*> Handoff;
+};
+
+static void JointTestPoolWorker(JointTestPoolShared* Shared, uint64_t Id, int Rounds)
+{
+	JointTestRandom Random((Id + 1) * 7919);
+	std::vector<std::atomic<uint64_t>*> Held;
+	for (int Round=0; Round <Rounds; Round++)
+	{
+		size_t Count = 1 + Random.Below(64);
+		for (size_t i=0; i <Count; i++)
+		{
+			std::atomic<uint64_t>* Owner = (std::atomic<uint64_t>*)Shared->Pool->Allocate();
+			if (!JOINTTEST_CHECK(Owner != nullptr))
+			{
+				break;
+			}
+			uint64_t Previous = Owner->exchange(JOINTTEST_LIVE | Id, std::memory_order_acq_rel);
+			JOINTTEST_CHECK(!JOINTTEST_IS_LIVE(Previous));
+			Held.push_back(Owner);
+		}
+
+		// Give a few blocks to whichever thread runs next and free a few of theirs, so blocks move between the
+		// per-CPU stacks instead of always going back where they came from.
+		{
+			std::lock_guard<std::mutex> Lock(Shared->HandoffMutex);
+			for (size_t i=0; i <Held.size() / 4; i++)
+			{
+				Shared->Handoff.push_back(Held.back());
+				Held.pop_back();
+			}
+			for (size_t i=0; i <Count / 4 && !Shared->Handoff.empty(); i++)
+			{
+				Held.push_back(Shared->Handoff.back());
+				Shared->Handoff.pop_back();
+			}
+		}
+
+		while (Held.size() > Random.Below(32))
+		{
+			std::atomic<uint64_t>* Owner = Held.back();
+			Held.pop_back();
+			Owner->store(0, std::memory_order_release);
+			Shared->Pool->Free(Owner);
+		}
+		if ((Round & 15) == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+	for (std::atomic<uint64_t>* Owner : Held)
+	{
+		Owner->store(0, std::memory_order_release);
+		Shared->Pool->Free(Owner);
+	}
+}
+
+static void JointTestConcurrentPool(uint64_t Seed)
+{
+	std::atomic<uint64_t>* Owner;
+	double* Payload;
+	JointPointer_t Elems[] =
+	{
+		JointPointer_t((void**)&Owner, sizeof(std::atomic<uint64_t>), std::alignment_of<std::atomic<uint64_t>>::value),
+		JointPointer_t((void**)&Payload, 5 * sizeof(double), std::alignment_of<double>::value),
+	};
+	JointConcurrentPool Pool(2, Elems);
+	JointTestPoolShared Shared;
+	Shared.Pool = &Pool;
+
+	unsigned int NumThreads = std::thread::hardware_concurrency();
+	NumThreads = NumThreads < 4 ? 4 : (NumThreads > 16 ? 16 : NumThreads);
+	std::vector<std::thread> Threads;
+	for (unsigned int i=0; i <NumThreads; i++)
+	{
+		Threads.push_back(std::thread(JointTestPoolWorker, &Shared, (uint32_t)((Seed << 8) + i), 2000));
+	}
+	for (std::thread& Thread : Threads)
+	{
+		Thread.join();
+	}
+	for (std::atomic<uint64_t>* Left : Shared.Handoff)
+	{
+		JOINTTEST_CHECK(JOINTTEST_IS_LIVE(Left->exchange(0)));
+		Pool.Free(Left);
+	}
+
+	// Every block is free again, so a single thread must be able to take them all back without seeing a duplicate.
+	std::vector<std::atomic<uint64_t>*> All;
+	for (int i=0; i <4096; i++)
+	{
+		std::atomic<uint64_t>* Block = (std::atomic<uint64_t>*)Pool.Allocate();
+		if (!JOINTTEST_CHECK(Block != nullptr))
+		{
+			break;
+		}
+		JOINTTEST_CHECK(!JOINTTEST_IS_LIVE(Block->exchange(JOINTTEST_LIVE)));
+		JOINTTEST_CHECK(((size_t)Block & (std::alignment_of<std::atomic<uint64_t>>::value - 1)) == 0);
+		All.push_back(Block);
+	}
+	for (std::atomic<uint64_t>* Block : All)
+	{
+		Block->store(0);
+		Pool.Free(Block);
+	}
+}
+
+// --- reallocate ---
+
+static unsigned char JointTestPattern(int Section, size_t Byte, uint64_t Generation)
+{
+	return (unsigned char)(Section * 31 + Byte * 7 + Generation * 13 + (Byte >> 8));
+}
+
+static void JointTestReallocate(uint64_t Seed)
+{
+	JointTestRandom Random(Seed);
+	for (int Layout=0; Layout <200; Layout++)
+	{
+		// malloc's alignment is the most realloc can keep, so stay within it.
+		int Num = 1 + (int)Random.Below(JOINTTEST_MAX_SECTIONS);
+		void* Pointers[JOINTTEST_MAX_SECTIONS];
+		JointPointer_t Elems[JOINTTEST_MAX_SECTIONS];
+		for (int i=0; i <Num; i++)
+		{
+			Elems[i] = JointPointer_t(&Pointers[i], Random.Below(4) == 0 ? 0 : Random.Below(3000), (size_t)1 << Random.Below(5));
+		}
+		size_t TotalSize = 0;
+		void* Memory = JointPointerAllocate(&TotalSize, malloc, Num, Elems);
+		if (!JOINTTEST_CHECK(Memory != nullptr))
+		{
+			return;
+		}
+		uint64_t Generation = 0;
+		for (int i=0; i <Num; i++)
+		{
+			for (size_t b=0; b <Elems[i].Size; b++)
+			{
+				((unsigned char*)Pointers[i])[b] = JointTestPattern(i, b, Generation);
+			}
+		}
+
+		for (int Step=0; Step <20; Step++)
+		{
+			JointPointer_t NewElems[JOINTTEST_MAX_SECTIONS];
+			for (int i=0; i <Num; i++)
+			{
+				NewElems[i] = Elems[i];
+				switch (Random.Below(4))
+				{
+					case 0: NewElems[i].Size = Elems[i].Size / 2; break;
+					case 1: NewElems[i].Size = Elems[i].Size * 2 + Random.Below(64); break;
+					case 2: NewElems[i].Size = Random.Below(5000); break;
+					default: break;
+				}
+			}
+
+			size_t NewTotalSize = 0;
+			void* Moved = JointPointerReallocate(Memory, &NewTotalSize, realloc, Num, Elems, NewElems);
+			if (!JOINTTEST_CHECK(Moved != nullptr))
+			{
+				break;
+			}
+			Memory = Moved;
+			JOINTTEST_CHECK(NewTotalSize == JointPointerTotalSize(Num, NewElems));
+
+			// Kept bytes must have survived the move; new bytes get the next generation's pattern.
+			Generation++;
+			for (int i=0; i <Num; i++)
+			{
+				unsigned char* Section = (unsigned char*)Pointers[i];
+				JOINTTEST_CHECK(Section == (unsigned char*)Memory + NewElems[i].Offset);
+				JOINTTEST_CHECK(((size_t)Section & (NewElems[i].Alignment - 1)) == 0);
+				JOINTTEST_CHECK(NewElems[i].Offset + NewElems[i].Size <= NewTotalSize);
+				size_t Kept = Elems[i].Size < NewElems[i].Size ? Elems[i].Size : NewElems[i].Size;
+				bool Same = true;
+				for (size_t b=0; b <Kept; b++)
+				{
+					Same = Same && Section[b] == JointTestPattern(i, b, Generation - 1);
+				}
+				JOINTTEST_CHECK(Same);
+				for (size_t b=0; b <NewElems[i].Size; b++)
+				{
+					Section[b] = JointTestPattern(i, b, Generation);
+				}
+			}
+			memcpy(Elems, NewElems, sizeof(JointPointer_t) * Num);
+		}
+		free(Memory);
+	}
+}
+
+// --- image_load ---
+
+static bool JointTestWriteFile(const char* Path, const void* Data, size_t Size)
+{
+	FILE* File = fopen(Path, "wb");
+	if (File == nullptr)
+	{
+		return false;
+	}
+	bool Ok = Size == 0 || fwrite(Data, Size, 1, File) == 1;
+	return fclose(File) == 0 && Ok;
+}
+
+static bool JointTestReadFile(const char* Path, std::vector<unsigned char>* Out)
+{
+	FILE* File = fopen(Path, "rb");
+	if (File == nullptr)
+	{
+		return false;
+	}
+	int Byte;
+	while ((Byte = fgetc(File)) != EOF)
+	{
+		Out->push_back((unsigned char)Byte);
+	}
+	fclose(File);
+	return true;
+}
+
+// Writes Bytes to Path and loads it the way the caller that saved it would.
+static bool JointTestLoadBytes(const char* Path, const std::vector<unsigned char>& Bytes, int Num, const JointPointer_t* Layout)
+{
+	if (!JointTestWriteFile(Path, Bytes.data(), Bytes.size()))
+	{
+		JOINTTEST_CHECK(!"can't write the test image");
+		return false;
+	}
+	JointPointer_t Elems[JOINTTEST_MAX_SECTIONS];
+	if (Num > 0)
+	{
+		memcpy(Elems, Layout, sizeof(JointPointer_t) * Num);
+	}
+	JointImage Image;
+	bool Loaded = JointImageLoad(&Image, Path, Num, Elems);
+	if (Loaded)
+	{
+		// Whatever was accepted must lie inside the file; read it all, so a bad pointer crashes here and not later.
+		size_t DataAt = (size_t)(Image.Data - (char*)Image.Mapping);
+		unsigned int Sum = 0;
+		for (uint32_t i=0; i <Image.Header->NumSections; i++)
+		{
+			const JointImageSection_t& Section = Image.Sections[i];
+			if (!JOINTTEST_CHECK(DataAt <= Image.MappingSize && Section.Offset <= Image.MappingSize - DataAt
+				&& Section.Size <= Image.MappingSize - DataAt - Section.Offset))
+			{
+				continue;
+			}
+			for (uint64_t b=0; b <Section.Size; b++)
+			{
+				Sum += ((const unsigned char*)Image.Data)[Section.Offset + b];
+			}
+		}
+		(void)Sum;
+		JointImageUnload(&Image);
+	}
+	return Loaded;
+}
+
+static void JointTestImageLoad(uint64_t Seed)
+{
+#if JOINTPOINTERMATH_HAS_MMAP
+	char Path[64];
+	snprintf(Path, sizeof(Path), "/tmp/jointpointertests.%d.jpi", (int)getpid());
+
+	float* Positions;
+	uint32_t* Indices;
+	char* Tag;
+	JointPointer_t Elems[] =
+	{
+		JointPointer_t((void**)&Positions, 300 * sizeof(float), 16),
+		JointPointer_t((void**)&Indices, 99 * sizeof(uint32_t), std::alignment_of<uint32_t>::value),
+		JointPointer_t((void**)&Tag, 5, 1),
+	};
+	const char* Names[] = { "positions", "indices", "tag" };
+	void* Memory = JointPointerAllocate(nullptr, malloc, Elems);
+	for (int i=0; i <300; i++)
+	{
+		Positions[i] = (float)i;
+	}
+	for (int i=0; i <99; i++)
+	{
+		Indices[i] = (uint32_t)(i * 3);
+	}
+	memcpy(Tag, "mesh", 5);
+	bool Saved = JointImageSave(Path, Memory, 3, Elems, Names);
+	free(Memory);
+	if (!JOINTTEST_CHECK(Saved))
+	{
+		return;
+	}
+	std::vector<unsigned char> Good;
+	if (!JOINTTEST_CHECK(JointTestReadFile(Path, &Good)) || !JOINTTEST_CHECK(Good.size() > sizeof(JointImageHeader_t)))
+	{
+		unlink(Path);
+		return;
+	}
+
+	// The untouched file loads, and the pointers land on the saved contents.
+	{
+		JointImage Image;
+		JOINTTEST_CHECK(JointImageLoad(&Image, Path, 3, Elems));
+		JOINTTEST_CHECK(Positions[299] == 299.0f && Indices[98] == 294 && strcmp(Tag, "mesh") == 0);
+		size_t Size = 0;
+		JOINTTEST_CHECK(JointImageFind(&Image, "indices", &Size) == Indices && Size == 99 * sizeof(uint32_t));
+		JointImageUnload(&Image);
+	}
+
+	// Every truncation, including the empty file.
+	for (size_t Length=0; Length <Good.size(); Length++)
+	{
+		std::vector<unsigned char> Truncated(Good.begin(), Good.begin() + Length);
+		JOINTTEST_CHECK(!JointTestLoadBytes(Path, Truncated, 3, Elems));
+		JOINTTEST_CHECK(!JointTestLoadBytes(Path, Truncated, 0, nullptr));
+	}
+
+	// One bad field at a time. Each of these would make the loader read outside the file or hand out a
+	// misaligned pointer if it were trusted.
+	const size_t SectionsAt = sizeof(JointImageHeader_t);
+	struct Corruption_t
+	{
+		const char* What;
+		size_t At;
+		uint64_t Value;
+		size_t Width;
+	};
+	const Corruption_t Corruptions[] =
+	{
+		{ "magic", offsetof(JointImageHeader_t, Magic), 0x4a504d49u, 4 },
+		{ "version", offsetof(JointImageHeader_t, Version), JOINTPOINTERMATH_IMAGE_VERSION + 1, 4 },
+		{ "header size", offsetof(JointImageHeader_t, HeaderSize), sizeof(JointImageHeader_t) + 8, 4 },
+		{ "section count too large", offsetof(JointImageHeader_t, NumSections), 0x7fffffffu, 4 },
+		{ "section count mismatch", offsetof(JointImageHeader_t, NumSections), 2, 4 },
+		{ "data offset past the end", offsetof(JointImageHeader_t, DataOffset), Good.size() + 1, 8 },
+		{ "data offset over the table", offsetof(JointImageHeader_t, DataOffset), sizeof(JointImageHeader_t), 8 },
+		{ "data offset wraps", offsetof(JointImageHeader_t, DataOffset), ~(uint64_t)0, 8 },
+		{ "total size too large", offsetof(JointImageHeader_t, TotalSize), Good.size(), 8 },
+		{ "total size wraps", offsetof(JointImageHeader_t, TotalSize), ~(uint64_t)0, 8 },
+		{ "section offset past the data", SectionsAt + offsetof(JointImageSection_t, Offset), Good.size(), 8 },
+		{ "section offset wraps", SectionsAt + sizeof(JointImageSection_t) + offsetof(JointImageSection_t, Offset), ~(uint64_t)0 - 8, 8 },
+		{ "section size past the data", SectionsAt + offsetof(JointImageSection_t, Size), Good.size(), 8 },
+		{ "section size wraps", SectionsAt + offsetof(JointImageSection_t, Size), ~(uint64_t)0, 8 },
+		{ "section size mismatch", SectionsAt + offsetof(JointImageSection_t, Size), 300 * sizeof(float) - 4, 8 },
+		{ "zero alignment", SectionsAt + offsetof(JointImageSection_t, Alignment), 0, 8 },
+		{ "misaligned section", SectionsAt + offsetof(JointImageSection_t, Offset), 4, 8 },
+	};
+	for (const Corruption_t& Corruption : Corruptions)
+	{
+		std::vector<unsigned char> Bad = Good;
+		memcpy(&Bad[Corruption.At], &Corruption.Value, Corruption.Width);
+		if (!JOINTTEST_CHECK(!JointTestLoadBytes(Path, Bad, 3, Elems)))
+		{
+			fprintf(stderr, "    accepted an image with a bad %s\n", Corruption.What);
+		}
+	}
+
+	// Random bytes in the header and the section table: the loader may accept some of them (a changed name, say),
+	// but every section it accepts must lie inside the file, which JointTestLoadBytes checks.
+	JointTestRandom Random(Seed);
+	size_t TableSize = sizeof(JointImageHeader_t) + 3 * sizeof(JointImageSection_t);
+	for (int i=0; i <2000; i++)
+	{
+		std::vector<unsigned char> Bad = Good;
+		size_t Count = 1 + Random.Below(4);
+		for (size_t c=0; c <Count; c++)
+		{
+			Bad[Random.Below(TableSize)] = (unsigned char)Random.Next();
+		}
+		JointTestLoadBytes(Path, Bad, 3, Elems);
+		JointTestLoadBytes(Path, Bad, 0, nullptr);
+	}
+	unlink(Path);
+#else
+	(void)Seed;
+	printf("image_load skipped, JointImageLoad needs mmap\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t Seed = 1;
+	for (int i=1; i <argc; i++)
+	{
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			Seed = strtoull(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--seed n]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	struct Test_t
+	{
+		const char* Name;
+		void (*Run)(uint64_t Seed);
+	};
+	const Test_t Tests[] =
+	{
+		{ "concurrent_pool", JointTestConcurrentPool },
+		{ "reallocate", JointTestReallocate },
+		{ "image_load", JointTestImageLoad },
+	};
+	for (const Test_t& Test : Tests)
+	{
+		int Before = JointTestFailures.load();
+		Test.Run(Seed);
+		int Failed = JointTestFailures.load() - Before;
+		printf("%-16s %s\n", Test.Name, Failed == 0 ? "ok" : "FAILED");
+	}
+
+	int Failures = JointTestFailures.load();
+	if (Failures != 0)
+	{
+		printf("%d checks failed (seed %llu)\n", Failures, (unsigned long long)Seed);
+	}
+	return Failures > 255 ? 255 : Failures;
+}